@@ -0,0 +1,57 @@
+/*
+  ==============================================================================
+
+    ActiveProfile.h
+
+    A device published as one atomic word: the device in the low half and
+    a version counter in the high half. The parameter listeners publish the
+    device the audio thread should render, which it reads once per block
+    instead of polling every device switch. The audio thread publishes the
+    device it actually rendered, program changes included, for the editor.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include "DeviceProfiles.h"
+
+class ActiveProfile
+{
+public:
+    struct Snapshot
+    {
+        Device device;
+        std::uint32_t version;
+    };
+
+    // Safe from any thread; concurrent publishers each bump the version once.
+    void publish (Device device) noexcept
+    {
+        auto current = state.load (std::memory_order_relaxed);
+
+        while (! state.compare_exchange_weak (current, pack (device, unpack (current).version + 1),
+                                              std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    Snapshot load() const noexcept { return unpack (state.load (std::memory_order_acquire)); }
+
+private:
+    static std::uint64_t pack (Device device, std::uint32_t version) noexcept
+    {
+        return (static_cast<std::uint64_t>(version) << 32) | static_cast<std::uint32_t>(device);
+    }
+
+    static Snapshot unpack (std::uint64_t packed) noexcept
+    {
+        return { static_cast<Device>(packed & 0xffffffffu), static_cast<std::uint32_t>(packed >> 32) };
+    }
+
+    std::atomic<std::uint64_t> state { pack (Device::flat, 0) };
+
+    static_assert (std::atomic<std::uint64_t>::is_always_lock_free, "The audio thread must never wait on the profile");
+};
@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    AnalyzerComponent.cpp
+
+  ==============================================================================
+*/
+
+#include "AnalyzerComponent.h"
+
+namespace
+{
+    constexpr double minFrequency = 20.0;
+    constexpr double maxFrequency = 20000.0;
+    constexpr float minDecibels = -90.f;
+    constexpr float maxDecibels = 6.f;
+
+    // The response curve gets its own, tighter scale; the profiles stay within about +-18 dB.
+    constexpr float responseRange = 24.f;
+}
+
+AnalyzerComponent::AnalyzerComponent (SpectrumAnalyzer& analyzerToUse, std::function<ResponseCurve::Settings()> responseSettingsToShow,
+                                      LoudnessMatcher& matcherToShow)
+    : analyzer (analyzerToUse), getResponseSettings (std::move (responseSettingsToShow)), loudnessMatcher (matcherToShow),
+      response (minFrequency, maxFrequency, responseRange)
+{
+    setInterceptsMouseClicks (false, false);
+
+    shownSettings = getResponseSettings();
+    shownSampleRate = analyzer.getSampleRate();
+
+    // Only runs the FFT thread and the output meter while there is something to draw them on.
+    analyzer.setActive (true);
+    loudnessMatcher.setOutputMetered (true);
+    startTimerHz (30);
+}
+
+AnalyzerComponent::~AnalyzerComponent()
+{
+    stopTimer();
+    analyzer.setActive (false);
+    loudnessMatcher.setOutputMetered (false);
+}
+
+void AnalyzerComponent::paint (juce::Graphics& g)
+{
+    auto bounds = getLocalBounds().toFloat();
+
+    g.setColour (juce::Colours::white.withAlpha (0.1f));
+
+    for (auto frequency : { 100.0, 1000.0, 10000.0 })
+        g.drawVerticalLine (juce::roundToInt (frequencyToX (frequency)), bounds.getY(), bounds.getBottom());
+
+    g.setColour (juce::Colours::white.withAlpha (0.35f));
+    g.strokePath (paths[static_cast<size_t>(SpectrumAnalyzer::Tap::pre)], juce::PathStrokeType (1.f));
+
+    g.setColour (juce::Colours::white);
+    g.strokePath (paths[static_cast<size_t>(SpectrumAnalyzer::Tap::post)], juce::PathStrokeType (1.f));
+
+    g.setColour (juce::Colour (64u, 194u, 230u));
+    g.strokePath (response.getPath (shownSettings, shownSampleRate, bounds), juce::PathStrokeType (1.5f));
+
+    g.setColour (juce::Colours::white.withAlpha (0.6f));
+    g.setFont (9.f);
+    g.drawFittedText (loudnessText, getLocalBounds().reduced (3, 2), juce::Justification::topRight, 2);
+}
+
+void AnalyzerComponent::resized()
+{
+    for (size_t tap = 0; tap < paths.size(); ++tap)
+        rebuildPath (tap);
+}
+
+void AnalyzerComponent::timerCallback()
+{
+    auto settings = getResponseSettings();
+    auto sampleRate = analyzer.getSampleRate();
+    auto changed = settings != shownSettings || sampleRate != shownSampleRate;
+
+    shownSettings = settings;
+    shownSampleRate = sampleRate;
+
+    auto text = formatLoudness();
+
+    if (text != loudnessText)
+    {
+        loudnessText = text;
+        changed = true;
+    }
+
+    for (size_t tap = 0; tap < spectra.size(); ++tap)
+    {
+        if (analyzer.getSpectrum (static_cast<SpectrumAnalyzer::Tap>(tap), spectra[tap], versions[tap]))
+        {
+            rebuildPath (tap);
+            changed = true;
+        }
+    }
+
+    if (changed)
+        repaint();
+}
+
+void AnalyzerComponent::rebuildPath (size_t tap)
+{
+    auto& path = paths[tap];
+    auto& spectrum = spectra[tap];
+    auto binWidth = analyzer.getSampleRate() / SpectrumAnalyzer::fftSize;
+
+    path.clear();
+
+    for (size_t bin = 1; bin < spectrum.size(); ++bin)
+    {
+        auto frequency = static_cast<double>(bin) * binWidth;
+
+        if (frequency < minFrequency)
+            continue;
+
+        if (frequency > maxFrequency)
+            break;
+
+        auto x = frequencyToX (frequency);
+        auto y = decibelsToY (spectrum[bin]);
+
+        if (path.isEmpty())
+            path.startNewSubPath (x, y);
+        else
+            path.lineTo (x, y);
+    }
+}
+
+juce::String AnalyzerComponent::formatLoudness() const
+{
+    auto& meter = loudnessMatcher.getOutputMeter();
+    auto format = [] (float lufs) { return lufs > LoudnessMeter::absoluteGate ? juce::String (lufs, 1) : juce::String ("-inf"); };
+
+    auto text = "S " + format (meter.getShortTerm()) + "  I " + format (meter.getIntegrated()) + " LUFS";
+    auto gain = loudnessMatcher.getAppliedGainDecibels();
+
+    if (std::abs (gain) >= 0.05f)
+        text << "\n" << (gain > 0.f ? "+" : "") << juce::String (gain, 1) << " dB match";
+
+    return text;
+}
+
+float AnalyzerComponent::frequencyToX (double frequency) const noexcept
+{
+    auto proportion = std::log (frequency / minFrequency) / std::log (maxFrequency / minFrequency);
+    return static_cast<float>(proportion) * static_cast<float>(getWidth());
+}
+
+float AnalyzerComponent::decibelsToY (float decibels) const noexcept
+{
+    return juce::jmap (juce::jlimit (minDecibels, maxDecibels, decibels), minDecibels, maxDecibels,
+                       static_cast<float>(getHeight()), 0.f);
+}
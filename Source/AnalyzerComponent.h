@@ -0,0 +1,55 @@
+/*
+  ==============================================================================
+
+    AnalyzerComponent.h
+
+    Draws the processor's pre/post spectrum, with the response curve of the
+    coefficients the audio thread is rendering on top. Paths are only rebuilt
+    when the analyzer thread has published a new frame, and the timer caps
+    repaints at 30 fps no matter how fast frames arrive. The output loudness is shown in the
+    corner, along with the gain loudness matching is applying.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "LoudnessMatcher.h"
+#include "ResponseCurve.h"
+#include "SpectrumAnalyzer.h"
+
+class AnalyzerComponent  : public juce::Component,
+                           private juce::Timer
+{
+public:
+    AnalyzerComponent (SpectrumAnalyzer& analyzerToUse, std::function<ResponseCurve::Settings()> responseSettingsToShow,
+                       LoudnessMatcher& matcherToShow);
+    ~AnalyzerComponent() override;
+
+    void paint (juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void timerCallback() override;
+    void rebuildPath (size_t tap);
+    juce::String formatLoudness() const;
+
+    float frequencyToX (double frequency) const noexcept;
+    float decibelsToY (float decibels) const noexcept;
+
+    SpectrumAnalyzer& analyzer;
+    std::function<ResponseCurve::Settings()> getResponseSettings;   // what the audio thread last rendered, program changes included
+    LoudnessMatcher& loudnessMatcher;
+
+    ResponseCurve response;
+    ResponseCurve::Settings shownSettings;
+    double shownSampleRate { 0.0 };
+    juce::String loudnessText;
+
+    std::array<SpectrumAnalyzer::Spectrum, SpectrumAnalyzer::numTaps> spectra {};
+    std::array<juce::uint32, SpectrumAnalyzer::numTaps> versions {};
+    std::array<juce::Path, SpectrumAnalyzer::numTaps> paths;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalyzerComponent)
+};
@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+    BiquadCascade.h
+
+    Fused five-section transposed direct form II cascade. Channels are packed
+    into the lanes of a juce::dsp::SIMDRegister, so one pass over the block
+    runs every section for up to SIMDNumElements channels at once.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include "CoefficientBank.h"
+
+template <typename SampleType>
+class BiquadCascade
+{
+public:
+    using Vec = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr int lanes = static_cast<int>(Vec::SIMDNumElements);
+
+    // Allocates state for numChannels and an interleaved scratch block of maximumBlockSize.
+    void prepare (int numChannels, int maximumBlockSize)
+    {
+        channels = numChannels;
+        groups.resize (static_cast<size_t>((numChannels + lanes - 1) / lanes));
+        interleaved.resize (static_cast<size_t>(maximumBlockSize));
+
+        for (auto& group : groups)
+            for (auto& section : group.coefficients)
+                section = makeSection ({});
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& group : groups)
+        {
+            group.s1.fill (Vec::expand (0));
+            group.s2.fill (Vec::expand (0));
+        }
+    }
+
+    int getNumChannels() const noexcept { return channels; }
+
+    // Loads one profile into every lane.
+    void setProfile (const ProfileCoefficients& profile) noexcept
+    {
+        for (auto& group : groups)
+            for (size_t band = 0; band < numBands; ++band)
+                group.coefficients[band] = makeSection (profile[band]);
+    }
+
+    // Loads a profile into a single channel's lane, leaving the other channels alone.
+    void setProfile (int channel, const ProfileCoefficients& profile) noexcept
+    {
+        jassert (channel >= 0 && channel < channels);
+
+        auto& group = groups[static_cast<size_t>(channel / lanes)];
+        auto lane = static_cast<size_t>(channel % lanes);
+
+        for (size_t band = 0; band < numBands; ++band)
+        {
+            auto& section = group.coefficients[band];
+            auto& c = profile[band];
+
+            section.b0.set (lane, static_cast<SampleType>(c.b0));
+            section.b1.set (lane, static_cast<SampleType>(c.b1));
+            section.b2.set (lane, static_cast<SampleType>(c.b2));
+            section.a1.set (lane, static_cast<SampleType>(c.a1));
+            section.a2.set (lane, static_cast<SampleType>(c.a2));
+        }
+    }
+
+    // Processes the block in place, in chunks of the block size prepare() was given.
+    void process (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        process (block, block);
+    }
+
+    // Reads channel n of input and writes channel n of output. Input channels may alias each other,
+    // which is how one signal gets fanned out across several lanes.
+    void process (const juce::dsp::AudioBlock<SampleType>& input, const juce::dsp::AudioBlock<SampleType>& output) noexcept
+    {
+        jassert (input.getNumSamples() == output.getNumSamples());
+
+        auto numChannels = juce::jmin (static_cast<int>(juce::jmin (input.getNumChannels(), output.getNumChannels())), channels);
+        auto numSamples = static_cast<int>(input.getNumSamples());
+        auto chunkSize = static_cast<int>(interleaved.size());
+
+        for (int start = 0; start < numSamples && chunkSize > 0; start += chunkSize)
+        {
+            auto chunkLength = juce::jmin (chunkSize, numSamples - start);
+            auto in = input.getSubBlock (static_cast<size_t>(start), static_cast<size_t>(chunkLength));
+            auto out = output.getSubBlock (static_cast<size_t>(start), static_cast<size_t>(chunkLength));
+
+            for (int first = 0, g = 0; first < numChannels; first += lanes, ++g)
+            {
+                auto channelsInGroup = juce::jmin (lanes, numChannels - first);
+
+                interleave (in, first, channelsInGroup, chunkLength);
+                processGroup (groups[static_cast<size_t>(g)], chunkLength);
+                deinterleave (out, first, channelsInGroup, chunkLength);
+            }
+        }
+    }
+
+private:
+    struct Section
+    {
+        Vec b0, b1, b2, a1, a2;
+    };
+
+    struct Group
+    {
+        std::array<Section, numBands> coefficients;
+        std::array<Vec, numBands> s1, s2;
+    };
+
+    static Section makeSection (const BiquadCoefficients& c) noexcept
+    {
+        return { Vec::expand (static_cast<SampleType>(c.b0)),
+                 Vec::expand (static_cast<SampleType>(c.b1)),
+                 Vec::expand (static_cast<SampleType>(c.b2)),
+                 Vec::expand (static_cast<SampleType>(c.a1)),
+                 Vec::expand (static_cast<SampleType>(c.a2)) };
+    }
+
+    void interleave (const juce::dsp::AudioBlock<SampleType>& block, int first, int channelsInGroup, int numSamples) noexcept
+    {
+        auto* dest = reinterpret_cast<SampleType*>(interleaved.data());
+
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            if (lane < channelsInGroup)
+            {
+                auto* src = block.getChannelPointer (static_cast<size_t>(first + lane));
+
+                for (int i = 0; i < numSamples; ++i)
+                    dest[i * lanes + lane] = src[i];
+            }
+            else
+            {
+                for (int i = 0; i < numSamples; ++i)
+                    dest[i * lanes + lane] = 0;
+            }
+        }
+    }
+
+    void deinterleave (const juce::dsp::AudioBlock<SampleType>& block, int first, int channelsInGroup, int numSamples) noexcept
+    {
+        auto* src = reinterpret_cast<const SampleType*>(interleaved.data());
+
+        for (int lane = 0; lane < channelsInGroup; ++lane)
+        {
+            auto* dest = block.getChannelPointer (static_cast<size_t>(first + lane));
+
+            for (int i = 0; i < numSamples; ++i)
+                dest[i] = src[i * lanes + lane];
+        }
+    }
+
+    void processGroup (Group& group, int numSamples) noexcept
+    {
+        // Everything the inner loop touches lives in locals so the compiler can keep it in registers.
+        auto c = group.coefficients;
+        auto s1 = group.s1;
+        auto s2 = group.s2;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            auto x = interleaved[static_cast<size_t>(i)];
+
+            for (size_t band = 0; band < numBands; ++band)
+            {
+                auto y = c[band].b0 * x + s1[band];
+                s1[band] = c[band].b1 * x - c[band].a1 * y + s2[band];
+                s2[band] = c[band].b2 * x - c[band].a2 * y;
+                x = y;
+            }
+
+            interleaved[static_cast<size_t>(i)] = x;
+        }
+
+        for (size_t band = 0; band < numBands; ++band)
+        {
+            group.s1[band] = snapToZero (s1[band]);
+            group.s2[band] = snapToZero (s2[band]);
+        }
+    }
+
+    static Vec snapToZero (Vec v) noexcept
+    {
+        for (size_t lane = 0; lane < Vec::SIMDNumElements; ++lane)
+        {
+            auto x = v.get (lane);
+            juce::dsp::util::snapToZero (x);
+            v.set (lane, x);
+        }
+
+        return v;
+    }
+
+    int channels { 0 };
+    std::vector<Group> groups;
+    std::vector<Vec> interleaved;
+};
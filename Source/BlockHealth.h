@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    BlockHealth.h
+
+    One SIMD pass over a block that finds its peak and whether anything in
+    it is NaN or infinite. The processor scans its input to spot silence and
+    garbage from upstream, and its output to catch a filter that blew up.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+template <typename SampleType>
+struct BlockHealth
+{
+    using Vec = juce::dsp::SIMDRegister<SampleType>;
+
+    SampleType peak { 0 };
+    bool finite { true };
+
+    bool isSilent (SampleType threshold) const noexcept { return finite && peak <= threshold; }
+
+    static BlockHealth scan (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        // x * 0 is 0 for every finite x and NaN for NaN or Inf, so one sum at the end checks the whole block.
+        auto peakVec = Vec::expand (0);
+        auto checkVec = Vec::expand (0);
+        SampleType peak = 0, check = 0;
+
+        auto scalar = [&] (SampleType x)
+        {
+            peak = juce::jmax (peak, std::abs (x));
+            check += x * 0;
+        };
+
+        for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+        {
+            auto* data = block.getChannelPointer (channel);
+            auto numSamples = block.getNumSamples();
+            size_t i = 0;
+
+            for (; i < numSamples && ! Vec::isSIMDAligned (data + i); ++i)
+                scalar (data[i]);
+
+            for (; i + Vec::SIMDNumElements <= numSamples; i += Vec::SIMDNumElements)
+            {
+                auto v = Vec::fromRawArray (data + i);
+                peakVec = Vec::max (peakVec, Vec::abs (v));
+                checkVec += v * static_cast<SampleType>(0);
+            }
+
+            for (; i < numSamples; ++i)
+                scalar (data[i]);
+        }
+
+        for (size_t lane = 0; lane < Vec::SIMDNumElements; ++lane)
+            peak = juce::jmax (peak, peakVec.get (lane));
+
+        return { peak, check + checkVec.sum() == 0 };
+    }
+};
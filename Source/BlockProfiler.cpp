@@ -0,0 +1,372 @@
+/*
+  ==============================================================================
+
+    BlockProfiler.cpp
+
+  ==============================================================================
+*/
+
+#include "BlockProfiler.h"
+
+namespace
+{
+    std::atomic<int> numInstances { 0 };
+
+    // Stats are republished a few times a second, which is as often as anyone can read them.
+    constexpr int publishIntervalMs = 250;
+
+    double getPercentile (std::vector<double>& values, double percentile)
+    {
+        if (values.empty())
+            return 0.0;
+
+        auto index = static_cast<size_t>(percentile * static_cast<double>(values.size() - 1) + 0.5);
+        std::nth_element (values.begin(), values.begin() + static_cast<std::ptrdiff_t>(index), values.end());
+        return values[index];
+    }
+}
+
+BlockProfiler::BlockProfiler()
+    : juce::Thread ("QwikRef profiler"),
+      microsPerTick (1.0e6 / static_cast<double>(juce::Time::getHighResolutionTicksPerSecond())),
+      instanceNumber (++numInstances)
+{
+    window.resize (static_cast<size_t>(windowSize));
+    sortScratch.reserve (static_cast<size_t>(windowSize));
+    trace.resize (static_cast<size_t>(traceSize));
+
+    published.instance = "QwikRef #" + juce::String (instanceNumber);
+}
+
+BlockProfiler::~BlockProfiler()
+{
+    stopThread (1000);
+}
+
+const char* BlockProfiler::getName (Stage stage) noexcept
+{
+    switch (stage)
+    {
+        case Stage::analyzer:  return "analyzer";
+        case Stage::bypass:    return "bypass";
+        case Stage::scan:      return "health scan";
+        case Stage::loudness:  return "loudness";
+        case Stage::render:    return "render";
+        case Stage::numStages:
+        default:               return "unknown";
+    }
+}
+
+void BlockProfiler::prepare (double newSampleRate)
+{
+    sampleRate.store (newSampleRate);
+    ticksPerSample = static_cast<double>(juce::Time::getHighResolutionTicksPerSecond()) / newSampleRate;
+
+    overruns.store (0);
+    worstBudget = 0.0;
+    worstSequence.fetch_add (1, std::memory_order_relaxed);
+    std::atomic_thread_fence (std::memory_order_release);
+    worstRecord = {};
+    worstSequence.fetch_add (1, std::memory_order_release);
+
+    resetPending.store (true);
+}
+
+void BlockProfiler::setActive (bool shouldBeActive)
+{
+    if (shouldBeActive)
+    {
+        if (isThreadRunning())
+            return;
+
+        resetPending.store (true);
+        startThread (juce::Thread::Priority::low);
+        active.store (true);
+    }
+    else
+    {
+        active.store (false);
+        stopThread (1000);
+    }
+}
+
+void BlockProfiler::setTrackName (const juce::String& name)
+{
+    const juce::SpinLock::ScopedLockType lock (publishLock);
+    trackName = name;
+}
+
+bool BlockProfiler::getStats (Stats& destination, juce::uint32& version) const
+{
+    const juce::SpinLock::ScopedLockType lock (publishLock);
+
+    if (version == publishedVersion)
+        return false;
+
+    destination = published;
+    version = publishedVersion;
+    return true;
+}
+
+bool BlockProfiler::exportTrace (const juce::File& file)
+{
+    int position, fill;
+    juce::String instance;
+
+    // Only the bounds are taken under the lock. The aggregation thread leaves the history alone until it
+    // is unfrozen, so the records can be read and formatted without holding it up.
+    {
+        const juce::SpinLock::ScopedLockType lock (publishLock);
+        instance = published.instance;
+        position = tracePosition;
+        fill = traceFill;
+        traceFrozen = true;
+    }
+
+    auto ok = writeTrace (file, instance, position, fill);
+
+    const juce::SpinLock::ScopedLockType lock (publishLock);
+    traceFrozen = false;
+    return ok;
+}
+
+bool BlockProfiler::writeTrace (const juce::File& file, const juce::String& instance, int position, int fill) const
+{
+    file.deleteFile();
+    juce::FileOutputStream stream (file);
+
+    if (stream.failedToOpen())
+        return false;
+
+    auto rate = sampleRate.load();
+
+    // Complete ("X") events, one per block with its stages nested inside, all on one track named after the instance.
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+           << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << instanceNumber << ",\"tid\":0,\"args\":{\"name\":"
+           << juce::JSON::toString (instance) << "}}";
+
+    auto writeEvent = [&] (const char* name, int thread, double startMicros, double durationMicros, const juce::String& args)
+    {
+        stream << ",\n{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":" << instanceNumber << ",\"tid\":" << thread << ",\"ts\":"
+               << juce::String (startMicros, 3) << ",\"dur\":" << juce::String (durationMicros, 3);
+
+        if (args.isNotEmpty())
+            stream << ",\"args\":{" << args << "}";
+
+        stream << "}";
+    };
+
+    auto writeBlock = [&] (const Record& block, int thread)
+    {
+        auto start = static_cast<double>(block.startTicks) * microsPerTick;
+        auto duration = static_cast<double>(block.endOffset) * microsPerTick;
+        auto budget = block.numSamples > 0 ? duration / (1.0e6 * block.numSamples / rate) : 0.0;
+
+        writeEvent ("processBlock", thread, start, duration,
+                    "\"samples\":" + juce::String (block.numSamples) + ",\"budget\":" + juce::String (budget, 4));
+
+        for (int j = 0; j < block.numSegments; ++j)
+        {
+            auto& segment = block.segments[static_cast<size_t>(j)];
+            auto end = j + 1 < block.numSegments ? block.segments[static_cast<size_t>(j + 1)].offset : block.endOffset;
+
+            writeEvent (getName (segment.stage), thread, start + segment.offset * microsPerTick,
+                        (end - segment.offset) * microsPerTick, {});
+        }
+    };
+
+    // Oldest first.
+    for (int i = 0; i < fill; ++i)
+        writeBlock (trace[static_cast<size_t>((position - fill + i + traceSize) % traceSize)], 0);
+
+    // The worst block since prepare gets a track of its own, since it was most likely timed while nobody was looking.
+    Record worstBlock;
+
+    if (readWorst (worstBlock) && worstBlock.numSamples > 0)
+    {
+        stream << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << instanceNumber << ",\"tid\":1,\"args\":{\"name\":\"worst block\"}}";
+        writeBlock (worstBlock, 1);
+    }
+
+    stream << "\n]}\n";
+    stream.flush();
+    return stream.getStatus().wasOk();
+}
+
+bool BlockProfiler::readWorst (Record& destination) const noexcept
+{
+    // The audio thread never waits for us, so a copy it overwrote halfway through is simply taken again.
+    for (int attempt = 0; attempt < 100; ++attempt)
+    {
+        auto before = worstSequence.load (std::memory_order_acquire);
+
+        if ((before & 1) == 0)
+        {
+            destination = worstRecord;
+            std::atomic_thread_fence (std::memory_order_acquire);
+
+            if (worstSequence.load (std::memory_order_relaxed) == before)
+                return true;
+        }
+
+        juce::Thread::yield();
+    }
+
+    return false;
+}
+
+BlockProfiler::Timing BlockProfiler::getTiming (const Record& record) const noexcept
+{
+    Timing timing;
+    timing.micros = record.endOffset * microsPerTick;
+    timing.budget = record.numSamples > 0 ? timing.micros / (1.0e6 * record.numSamples / sampleRate.load()) : 0.0;
+
+    for (int i = 0; i < record.numSegments; ++i)
+    {
+        auto& segment = record.segments[static_cast<size_t>(i)];
+        auto end = i + 1 < record.numSegments ? record.segments[static_cast<size_t>(i + 1)].offset : record.endOffset;
+        timing.stageMicros[static_cast<size_t>(segment.stage)] += (end - segment.offset) * microsPerTick;
+    }
+
+    return timing;
+}
+
+void BlockProfiler::run()
+{
+    auto lastPublish = juce::Time::getMillisecondCounter();
+    auto changed = false;
+
+    while (! threadShouldExit())
+    {
+        if (resetPending.exchange (false))
+        {
+            clear();
+            changed = true;
+        }
+
+        while (fifo.getNumReady() > 0)
+        {
+            int start1, size1, start2, size2;
+            fifo.prepareToRead (fifo.getNumReady(), start1, size1, start2, size2);
+
+            for (int i = 0; i < size1; ++i)
+                aggregate (records[static_cast<size_t>(start1 + i)]);
+
+            for (int i = 0; i < size2; ++i)
+                aggregate (records[static_cast<size_t>(start2 + i)]);
+
+            fifo.finishedRead (size1 + size2);
+            changed = true;
+        }
+
+        auto now = juce::Time::getMillisecondCounter();
+
+        if (changed && now - lastPublish >= static_cast<juce::uint32>(publishIntervalMs))
+        {
+            publish();
+            lastPublish = now;
+            changed = false;
+        }
+
+        wait (50);
+    }
+}
+
+void BlockProfiler::clear()
+{
+    // Whatever is still queued was timed against the previous sample rate and block size.
+    fifo.finishedRead (fifo.getNumReady());
+    dropped.store (0);
+
+    windowPosition = windowFill = 0;
+
+    const juce::SpinLock::ScopedLockType lock (publishLock);
+    tracePosition = traceFill = 0;
+}
+
+void BlockProfiler::aggregate (const Record& record)
+{
+    window[static_cast<size_t>(windowPosition)] = getTiming (record);
+    windowPosition = (windowPosition + 1) % windowSize;
+    windowFill = juce::jmin (windowFill + 1, windowSize);
+
+    const juce::SpinLock::ScopedLockType lock (publishLock);
+
+    if (traceFrozen)
+        return;
+
+    trace[static_cast<size_t>(tracePosition)] = record;
+    tracePosition = (tracePosition + 1) % traceSize;
+    traceFill = juce::jmin (traceFill + 1, traceSize);
+}
+
+void BlockProfiler::publish()
+{
+    Stats stats;
+    stats.numBlocks = windowFill;
+    stats.minMicros = std::numeric_limits<double>::max();
+
+    for (int i = 0; i < windowFill; ++i)
+    {
+        auto& timing = window[static_cast<size_t>(i)];
+
+        stats.minMicros = juce::jmin (stats.minMicros, timing.micros);
+        stats.maxMicros = juce::jmax (stats.maxMicros, timing.micros);
+        stats.meanMicros += timing.micros;
+        stats.meanBudget += timing.budget;
+        stats.maxBudget = juce::jmax (stats.maxBudget, timing.budget);
+
+        for (size_t stage = 0; stage < timing.stageMicros.size(); ++stage)
+        {
+            stats.stageMeanMicros[stage] += timing.stageMicros[stage];
+            stats.stageMaxMicros[stage] = juce::jmax (stats.stageMaxMicros[stage], timing.stageMicros[stage]);
+        }
+    }
+
+    if (windowFill > 0)
+    {
+        auto scale = 1.0 / windowFill;
+        stats.meanMicros *= scale;
+        stats.meanBudget *= scale;
+
+        for (auto& mean : stats.stageMeanMicros)
+            mean *= scale;
+    }
+    else
+    {
+        stats.minMicros = 0.0;
+    }
+
+    auto p99 = [this] (double Timing::* field)
+    {
+        sortScratch.clear();
+
+        for (int i = 0; i < windowFill; ++i)
+            sortScratch.push_back (window[static_cast<size_t>(i)].*field);
+
+        return getPercentile (sortScratch, 0.99);
+    };
+
+    stats.p99Micros = p99 (&Timing::micros);
+    stats.p99Budget = p99 (&Timing::budget);
+
+    stats.overruns = overruns.load();
+    stats.dropped = dropped.load();
+
+    Record worstBlock;
+
+    if (readWorst (worstBlock) && worstBlock.numSamples > 0)
+    {
+        auto worst = getTiming (worstBlock);
+        auto age = static_cast<double>(juce::Time::getHighResolutionTicks() - worstBlock.startTicks) * microsPerTick * 1.0e-6;
+
+        stats.worstBudget = worst.budget;
+        stats.worstStageMicros = worst.stageMicros;
+        stats.worstTime = juce::Time::getCurrentTime() - juce::RelativeTime::seconds (age);
+    }
+
+    const juce::SpinLock::ScopedLockType lock (publishLock);
+    stats.instance = "QwikRef #" + juce::String (instanceNumber) + (trackName.isNotEmpty() ? " on " + trackName : juce::String());
+    published = std::move (stats);
+    ++publishedVersion;
+}
@@ -0,0 +1,217 @@
+/*
+  ==============================================================================
+
+    BlockProfiler.h
+
+    Per-instance timing of processBlock. The audio thread timestamps the
+    stages of each block and hands the record to a single-producer/
+    single-consumer ring; a background thread turns the records into
+    min/mean/p99/max times, budget use and per-stage costs, keeps the worst
+    block it has seen, and holds the most recent blocks for a Chrome/Perfetto
+    trace export. The editor polls the stats on a timer.
+
+    Two figures are kept on the audio thread whatever happens, since a
+    dropout in a big session usually comes with every editor closed: how
+    many blocks went over budget, and the worst block with its stages. The
+    detailed history, the ring and the thread only run while the editor's
+    panel is showing or exporting.
+
+    Every instance gets its own number, and the host's track name if it
+    provides one, so a trace or a screenshot says which instance dropped out.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+class BlockProfiler  : private juce::Thread
+{
+public:
+    // Where the time in a block goes, in the order processBlock gets to them.
+    enum class Stage { analyzer, bypass, scan, loudness, render, numStages };
+
+    static constexpr int numStages = static_cast<int>(Stage::numStages);
+    static constexpr int maxSegments = 16;
+
+    static const char* getName (Stage stage) noexcept;
+
+    struct Stats
+    {
+        juce::String instance;
+        int numBlocks { 0 };     // in the window the times below cover
+
+        double minMicros { 0.0 }, meanMicros { 0.0 }, p99Micros { 0.0 }, maxMicros { 0.0 };
+        double meanBudget { 0.0 }, p99Budget { 0.0 }, maxBudget { 0.0 };   // fractions of the block's duration
+        std::array<double, numStages> stageMeanMicros {}, stageMaxMicros {};
+
+        juce::int64 overruns { 0 };   // blocks over budget since prepare, panel open or not
+        juce::int64 dropped { 0 };    // records lost to a full ring
+
+        // The block that used the most of its budget since prepare, panel open or not, and where its time went.
+        double worstBudget { 0.0 };
+        std::array<double, numStages> worstStageMicros {};
+        juce::Time worstTime;
+    };
+
+    BlockProfiler();
+    ~BlockProfiler() override;
+
+    // Called from prepareToPlay, while the audio thread is stopped. Clears everything seen so far.
+    void prepare (double newSampleRate);
+
+    // Message thread: starts or stops the detailed history and the aggregation thread. Starting clears the
+    // old window and trace; the overrun count and the worst block carry on regardless.
+    void setActive (bool shouldBeActive);
+
+    // Any thread but the audio thread.
+    void setTrackName (const juce::String& name);
+
+    // Audio thread: wait-free, never allocates. A block whose record doesn't fit in the ring is dropped.
+    // While inactive each block costs a few timestamps and a comparison against the worst so far.
+    void beginBlock (int numSamples) noexcept
+    {
+        collecting = active.load (std::memory_order_relaxed);
+
+        current.startTicks = juce::Time::getHighResolutionTicks();
+        current.numSamples = numSamples;
+        current.numSegments = 0;
+    }
+
+    // Audio thread: everything from here until the next call (or endBlock) counts towards 'stage'.
+    void enterStage (Stage stage) noexcept
+    {
+        if (current.numSegments > 0 && current.segments[static_cast<size_t>(current.numSegments - 1)].stage == stage)
+            return;
+
+        if (current.numSegments < maxSegments)
+            current.segments[static_cast<size_t>(current.numSegments++)] = { stage, getOffset() };
+    }
+
+    void endBlock() noexcept
+    {
+        current.endOffset = getOffset();
+        checkBudget();
+
+        if (! collecting)
+            return;
+
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite (1, start1, size1, start2, size2);
+
+        if (size1 + size2 == 0)
+        {
+            dropped.fetch_add (1, std::memory_order_relaxed);
+            return;
+        }
+
+        records[static_cast<size_t>(size1 > 0 ? start1 : start2)] = current;
+        fifo.finishedWrite (1);
+    }
+
+    // Message thread: copies the latest stats if they changed since 'version'.
+    bool getStats (Stats& destination, juce::uint32& version) const;
+
+    // Message thread: writes the blocks still in the trace history as Chrome trace events (JSON), which
+    // chrome://tracing and ui.perfetto.dev both open. The history is frozen while the file is written, so
+    // blocks that finish meanwhile are counted but don't make it into the trace.
+    bool exportTrace (const juce::File& file);
+
+private:
+    struct Segment
+    {
+        Stage stage;
+        juce::uint32 offset;   // ticks after the start of the block
+    };
+
+    struct Record
+    {
+        juce::int64 startTicks { 0 };
+        int numSamples { 0 };
+        int numSegments { 0 };
+        juce::uint32 endOffset { 0 };
+        std::array<Segment, maxSegments> segments {};
+    };
+
+    juce::uint32 getOffset() const noexcept
+    {
+        return static_cast<juce::uint32>(juce::Time::getHighResolutionTicks() - current.startTicks);
+    }
+
+    // Audio thread: counts the block if it overran and keeps it if it's the worst yet. The copy is bracketed
+    // by worstSequence going odd and back to even, so a reader can tell a torn copy and try again.
+    void checkBudget() noexcept
+    {
+        if (current.numSamples <= 0)
+            return;
+
+        auto budget = static_cast<double>(current.endOffset) / (current.numSamples * ticksPerSample);
+
+        if (budget > 1.0)
+            overruns.fetch_add (1, std::memory_order_relaxed);
+
+        if (budget <= worstBudget)
+            return;
+
+        worstBudget = budget;
+        worstSequence.fetch_add (1, std::memory_order_relaxed);
+        std::atomic_thread_fence (std::memory_order_release);
+        worstRecord = current;
+        worstSequence.fetch_add (1, std::memory_order_release);
+    }
+
+    struct Timing
+    {
+        double micros { 0.0 }, budget { 0.0 };
+        std::array<double, numStages> stageMicros {};
+    };
+
+    void run() override;
+    bool writeTrace (const juce::File& file, const juce::String& instance, int position, int fill) const;
+    bool readWorst (Record& destination) const noexcept;
+    Timing getTiming (const Record& record) const noexcept;
+    void clear();
+    void aggregate (const Record& record);
+    void publish();
+
+    static constexpr int ringSize = 1024;
+    static constexpr int windowSize = 2048;
+    static constexpr int traceSize = 8192;
+
+    // Audio thread only, apart from prepare().
+    Record current;
+    bool collecting { false };
+    double ticksPerSample { 1.0 };
+    double worstBudget { 0.0 };
+
+    // Written by the audio thread whether or not the profiler is active.
+    std::atomic<juce::int64> overruns { 0 };
+    std::atomic<juce::uint32> worstSequence { 0 };   // odd while worstRecord is being written
+    Record worstRecord;
+
+    juce::AbstractFifo fifo { ringSize };
+    std::vector<Record> records = std::vector<Record> (static_cast<size_t>(ringSize));
+    std::atomic<juce::int64> dropped { 0 };
+    std::atomic<double> sampleRate { 44100.0 };
+    std::atomic<bool> resetPending { false };
+    std::atomic<bool> active { false };
+
+    // Owned by the aggregation thread.
+    const double microsPerTick;
+    std::vector<Timing> window;
+    int windowPosition { 0 }, windowFill { 0 };
+    std::vector<double> sortScratch;
+
+    // Shared with the message thread; neither side is the audio thread, so a lock is fine here.
+    mutable juce::SpinLock publishLock;
+    Stats published;
+    juce::uint32 publishedVersion { 0 };
+    const int instanceNumber;
+    juce::String trackName;
+    std::vector<Record> trace;
+    int tracePosition { 0 }, traceFill { 0 };
+    bool traceFrozen { false };   // set while exportTrace reads the history outside the lock
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BlockProfiler)
+};
@@ -0,0 +1,182 @@
+/*
+  ==============================================================================
+
+    ChannelGroups.h
+
+    Per-channel-group routing for surround beds. Most channels follow the
+    selected device, but some speakers get their own treatment: the LFE can
+    be left untouched and the centre can be heard as a phone speaker.
+
+    Those channels are captured dry before the main render. Rendered side
+    channels run through a side BiquadCascade (one lane each, so they still
+    share a single SIMD pass), are delayed to match the main path's latency
+    and written back before loudness matching. Bypassed channels skip the
+    cascade and the match gain: they are only delayed, and go back in once
+    the gain has been applied.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include "BiquadCascade.h"
+
+template <typename SampleType>
+class ChannelGroups
+{
+public:
+    enum class Role { follow, bypass, phone };
+
+    explicit ChannelGroups (const CoefficientBank& bankToUse) : bank (bankToUse) {}
+
+    void prepare (const juce::AudioChannelSet& layout, double sampleRate, int maximumBlockSize, int maximumLatency)
+    {
+        types.clear();
+
+        for (int channel = 0; channel < layout.size(); ++channel)
+            types.push_back (layout.getTypeOfChannel (channel));
+
+        auto numChannels = static_cast<int>(types.size());
+
+        sideChannels.clear();
+        sideChannels.reserve (types.size());
+        sidePointers.resize (types.size());
+        numRendered = 0;
+
+        sideBuffer.setSize (numChannels, maximumBlockSize);
+        cascade.prepare (numChannels, maximumBlockSize);
+
+        delay.setMaximumDelayInSamples (juce::jmax (1, maximumLatency));
+        delay.prepare ({ sampleRate, static_cast<juce::uint32>(maximumBlockSize), static_cast<juce::uint32>(juce::jmax (1, numChannels)) });
+
+        optionsKnown = false;
+    }
+
+    void reset() noexcept
+    {
+        cascade.reset();
+        delay.reset();
+    }
+
+    // Re-assigns roles from the channel types. Cheap when nothing changed, so it can run every block.
+    void setOptions (bool bypassLfe, bool centreAsPhone) noexcept
+    {
+        if (optionsKnown && bypassLfe == lfeBypassed && centreAsPhone == centrePhone)
+            return;
+
+        lfeBypassed = bypassLfe;
+        centrePhone = centreAsPhone;
+        optionsKnown = true;
+
+        // Rendered channels take the first cascade lanes; the bypassed ones come after and never reach it.
+        sideChannels.clear();
+
+        for (auto wanted : { Role::phone, Role::bypass })
+        {
+            for (size_t channel = 0; channel < types.size(); ++channel)
+            {
+                if (getRole (types[channel]) != wanted)
+                    continue;
+
+                if (wanted == Role::phone)
+                    cascade.setProfile (static_cast<int>(sideChannels.size()), bank.getProfile (Device::phone));
+
+                sideChannels.push_back (static_cast<int>(channel));
+            }
+
+            if (wanted == Role::phone)
+                numRendered = sideChannels.size();
+        }
+
+        reset();
+    }
+
+    bool hasSideChannels() const noexcept { return ! sideChannels.empty(); }
+    bool hasBypassedChannels() const noexcept { return sideChannels.size() > numRendered; }
+
+    // Keeps a dry copy of every side channel before the main path overwrites it.
+    void capture (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        jassert (block.getNumSamples() <= static_cast<size_t>(sideBuffer.getNumSamples()));
+
+        auto numSamples = juce::jmin (block.getNumSamples(), static_cast<size_t>(sideBuffer.getNumSamples()));
+
+        for (size_t i = 0; i < sideChannels.size(); ++i)
+        {
+            auto channel = static_cast<size_t>(sideChannels[i]);
+
+            if (channel < block.getNumChannels())
+                juce::FloatVectorOperations::copy (sideBuffer.getWritePointer (static_cast<int>(i)), block.getChannelPointer (channel),
+                                                   static_cast<int>(numSamples));
+        }
+    }
+
+    // Renders the side channels that have a role of their own and writes them back, delayed by the main path's latency.
+    void render (const juce::dsp::AudioBlock<SampleType>& block, int latencySamples) noexcept
+    {
+        auto numSamples = juce::jmin (block.getNumSamples(), static_cast<size_t>(sideBuffer.getNumSamples()));
+
+        for (size_t i = 0; i < sideChannels.size(); ++i)
+            sidePointers[i] = sideBuffer.getWritePointer (static_cast<int>(i));
+
+        if (numRendered > 0)
+            cascade.process (juce::dsp::AudioBlock<SampleType> (sidePointers.data(), numRendered, numSamples));
+
+        writeBack (block, 0, numRendered, latencySamples);
+    }
+
+    // Call after loudness matching: writes the bypassed channels back as they came in, only delayed by the latency.
+    void restoreBypassed (const juce::dsp::AudioBlock<SampleType>& block, int latencySamples) noexcept
+    {
+        writeBack (block, numRendered, sideChannels.size(), latencySamples);
+    }
+
+private:
+    Role getRole (juce::AudioChannelSet::ChannelType type) const noexcept
+    {
+        if (lfeBypassed && (type == juce::AudioChannelSet::LFE || type == juce::AudioChannelSet::LFE2))
+            return Role::bypass;
+
+        if (centrePhone && type == juce::AudioChannelSet::centre)
+            return Role::phone;
+
+        return Role::follow;
+    }
+
+    void writeBack (const juce::dsp::AudioBlock<SampleType>& block, size_t first, size_t last, int latencySamples) noexcept
+    {
+        auto numSamples = juce::jmin (block.getNumSamples(), static_cast<size_t>(sideBuffer.getNumSamples()));
+        delay.setDelay (static_cast<SampleType>(juce::jlimit (0, delay.getMaximumDelayInSamples(), latencySamples)));
+
+        for (size_t i = first; i < last; ++i)
+        {
+            auto channel = sideChannels[i];
+
+            if (static_cast<size_t>(channel) >= block.getNumChannels())
+                continue;
+
+            auto* source = sideBuffer.getReadPointer (static_cast<int>(i));
+            auto* destination = block.getChannelPointer (static_cast<size_t>(channel));
+
+            for (size_t n = 0; n < numSamples; ++n)
+            {
+                delay.pushSample (channel, source[n]);
+                destination[n] = delay.popSample (channel);
+            }
+        }
+    }
+
+    const CoefficientBank& bank;
+
+    std::vector<juce::AudioChannelSet::ChannelType> types;
+    std::vector<int> sideChannels;   // rendered ones first, then the bypassed ones
+    size_t numRendered { 0 };
+    std::vector<SampleType*> sidePointers;
+
+    juce::AudioBuffer<SampleType> sideBuffer;
+    BiquadCascade<SampleType> cascade;
+    juce::dsp::DelayLine<SampleType, juce::dsp::DelayLineInterpolationTypes::None> delay;
+
+    bool lfeBypassed { false }, centrePhone { false }, optionsKnown { false };
+};
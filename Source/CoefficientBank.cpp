@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    CoefficientBank.cpp
+
+  ==============================================================================
+*/
+
+#include "CoefficientBank.h"
+
+void CoefficientBank::prepare (double newSampleRate)
+{
+    if (newSampleRate == sampleRate)
+        return;
+
+    sampleRate = newSampleRate;
+
+    for (auto& row : deviceProfiles)
+    {
+        auto& profile = profiles[static_cast<size_t>(row.device)];
+        auto& svfProfile = svfProfiles[static_cast<size_t>(row.device)];
+
+        for (size_t band = 0; band < row.bands.size(); ++band)
+        {
+            profile[band] = design (row.bands[band], sampleRate);
+            svfProfile[band] = designSvf (row.bands[band], sampleRate);
+        }
+
+        // Scaling a section's outputs (b0 b1 b2 for the biquad, m0 m1 m2 for the SVF) scales the whole cascade.
+        auto gain = 1.0 / measurePinkGain (row.device);
+        auto& matched = matchedProfiles[static_cast<size_t>(row.device)];
+        auto& matchedSvf = matchedSvfProfiles[static_cast<size_t>(row.device)];
+
+        matched = profile;
+        matched.back().b0 *= gain;
+        matched.back().b1 *= gain;
+        matched.back().b2 *= gain;
+
+        matchedSvf = svfProfile;
+        matchedSvf.back().m0 *= gain;
+        matchedSvf.back().m1 *= gain;
+        matchedSvf.back().m2 *= gain;
+
+        compensationGains[static_cast<size_t>(row.device)] = gain;
+        tailSamples[static_cast<size_t>(row.device)] = measureTail (profile);
+    }
+}
+
+int CoefficientBank::measureTail (const ProfileCoefficients& profile) noexcept
+{
+    // Each section decays as its slowest pole, r^n. Summing the sections' times to fall by 100 dB
+    // over-estimates the cascade a little, which is the safe side for a tail.
+    constexpr double decay = 1.0e-5;
+    auto total = 0.0;
+
+    for (auto& c : profile)
+    {
+        auto discriminant = c.a1 * c.a1 - 4.0 * c.a2;
+        auto radius = discriminant < 0.0 ? std::sqrt (c.a2)
+                                         : 0.5 * (std::abs (c.a1) + std::sqrt (discriminant));
+
+        if (radius <= 0.0)
+            continue;
+
+        jassert (radius < 1.0);
+        total += std::log (decay) / std::log (juce::jmin (radius, 1.0 - 1.0e-9));
+    }
+
+    return static_cast<int>(std::ceil (total));
+}
+
+double CoefficientBank::measurePinkGain (Device device) const noexcept
+{
+    // Pink noise has equal power per octave, so a log-spaced grid weights every point equally.
+    constexpr size_t numPoints = 256;
+    constexpr double lowest = 20.0;
+    auto highest = juce::jmin (20000.0, sampleRate * 0.49);
+
+    std::array<double, numPoints> frequencies, magnitudes;
+
+    for (size_t i = 0; i < numPoints; ++i)
+        frequencies[i] = lowest * std::pow (highest / lowest, static_cast<double>(i) / static_cast<double>(numPoints - 1));
+
+    getMagnitudeForFrequencyArray (device, frequencies.data(), magnitudes.data(), numPoints);
+
+    auto power = 0.0;
+
+    for (auto magnitude : magnitudes)
+        power += magnitude * magnitude;
+
+    return std::sqrt (juce::jmax (power / static_cast<double>(numPoints), 1.0e-12));
+}
+
+void CoefficientBank::getMagnitudeForFrequencyArray (Device device, const double* frequencies, double* magnitudes, size_t numFrequencies) const noexcept
+{
+    getMagnitudeForFrequencyArray (getProfile (device), sampleRate, frequencies, magnitudes, numFrequencies);
+}
+
+void CoefficientBank::getMagnitudeForFrequencyArray (const ProfileCoefficients& profile, double rate, const double* frequencies,
+                                                     double* magnitudes, size_t numFrequencies) noexcept
+{
+    jassert (rate > 0.0);
+
+    // On the unit circle |b0 + b1 z + b2 z^2|^2 = n0 + n1 cos(w) + n2 cos(2w), and the same for the poles,
+    // so each section folds down to six constants and the loop below needs one cosine per frequency.
+    struct PowerTerms { double n0, n1, n2, d0, d1, d2; };
+    std::array<PowerTerms, numBands> terms;
+
+    for (size_t band = 0; band < numBands; ++band)
+    {
+        auto& c = profile[band];
+        terms[band] = { c.b0 * c.b0 + c.b1 * c.b1 + c.b2 * c.b2, 2.0 * (c.b0 * c.b1 + c.b1 * c.b2), 2.0 * c.b0 * c.b2,
+                        1.0 + c.a1 * c.a1 + c.a2 * c.a2,         2.0 * (c.a1 + c.a1 * c.a2),        2.0 * c.a2 };
+    }
+
+    const auto radiansPerHz = juce::MathConstants<double>::twoPi / rate;
+
+    for (size_t i = 0; i < numFrequencies; ++i)
+    {
+        auto cosW = std::cos (radiansPerHz * frequencies[i]);
+        auto cos2W = 2.0 * cosW * cosW - 1.0;
+        auto power = 1.0;
+
+        for (auto& t : terms)
+            power *= (t.n0 + t.n1 * cosW + t.n2 * cos2W) / (t.d0 + t.d1 * cosW + t.d2 * cos2W);
+
+        magnitudes[i] = std::sqrt (juce::jmax (0.0, power));
+    }
+}
+
+void CoefficientBank::getMagnitudeForFrequencyArray (const SvfProfile& profile, double rate, const double* frequencies,
+                                                     double* magnitudes, size_t numFrequencies) noexcept
+{
+    jassert (rate > 0.0);
+
+    // The trapezoidal SVF is the bilinear transform of m0 + (m1 s + m2) / (s^2 + k s + 1), with s = j tan(w / 2) / g
+    // on the unit circle, so every section only needs that one tangent per frequency.
+    const auto radiansPerHz = juce::MathConstants<double>::pi / rate;
+
+    for (size_t i = 0; i < numFrequencies; ++i)
+    {
+        auto tanHalfW = std::tan (radiansPerHz * frequencies[i]);
+        auto power = 1.0;
+
+        for (auto& c : profile)
+        {
+            auto t = tanHalfW / c.g;
+            auto real = 1.0 - t * t;
+            auto numeratorReal = c.m0 * real + c.m2;
+            auto numeratorImag = t * (c.m0 * c.k + c.m1);
+
+            power *= (numeratorReal * numeratorReal + numeratorImag * numeratorImag) / (real * real + c.k * c.k * t * t);
+        }
+
+        magnitudes[i] = std::sqrt (juce::jmax (0.0, power));
+    }
+}
+
+BiquadCoefficients CoefficientBank::design (const Band& band, double sampleRate)
+{
+    using Coefs = juce::dsp::IIR::Coefficients<double>;
+
+    auto gain = juce::Decibels::decibelsToGain (band.gainDb);
+    Coefs::Ptr section;
+
+    switch (band.type)
+    {
+        case BandType::highPass:  section = Coefs::makeHighPass (sampleRate, band.frequency, band.q); break;
+        case BandType::lowPass:   section = Coefs::makeLowPass (sampleRate, band.frequency, band.q); break;
+        case BandType::lowShelf:  section = Coefs::makeLowShelf (sampleRate, band.frequency, band.q, gain); break;
+        case BandType::highShelf: section = Coefs::makeHighShelf (sampleRate, band.frequency, band.q, gain); break;
+        case BandType::peak:      section = Coefs::makePeakFilter (sampleRate, band.frequency, band.q, gain); break;
+        case BandType::bypass:
+        default:                  return {};
+    }
+
+    // Every design we use is second order, stored as b0 b1 b2 a1 a2 with a0 normalised out.
+    jassert (section->getFilterOrder() == 2);
+    auto* raw = section->getRawCoefficients();
+
+    return { raw[0], raw[1], raw[2], raw[3], raw[4] };
+}
+
+SvfCoefficients CoefficientBank::designSvf (const Band& band, double sampleRate)
+{
+    // Same responses as the RBJ designs above, in Andrew Simper's SVF formulation.
+    auto A = std::pow (10.0, band.gainDb / 40.0);
+    auto g = std::tan (juce::MathConstants<double>::pi * juce::jmin (static_cast<double>(band.frequency), sampleRate * 0.49) / sampleRate);
+    auto k = 1.0 / band.q;
+
+    auto make = [] (double gain, double damping, double m0, double m1, double m2)
+    {
+        return SvfCoefficients { gain, damping, m0, m1, m2 };
+    };
+
+    switch (band.type)
+    {
+        case BandType::highPass:  return make (g, k, 1.0, -k, -1.0);
+        case BandType::lowPass:   return make (g, k, 0.0, 0.0, 1.0);
+        case BandType::lowShelf:  return make (g / std::sqrt (A), k, 1.0, k * (A - 1.0), A * A - 1.0);
+        case BandType::highShelf: return make (g * std::sqrt (A), k, A * A, k * (1.0 - A) * A, 1.0 - A * A);
+        case BandType::peak:      return make (g, 1.0 / (band.q * A), 1.0, (A * A - 1.0) / (band.q * A), 0.0);
+        case BandType::bypass:
+        default:                  return make (g, 1.0, 1.0, 0.0, 0.0);
+    }
+}
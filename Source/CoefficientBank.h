@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    CoefficientBank.h
+
+    Holds the five biquad sections of every device profile, designed once per
+    sample rate so the audio thread never allocates or does trig.
+
+    Each profile also gets a loudness-matched copy: its broadband gain under
+    pink noise is measured at design time and divided out of the last
+    section's numerator, so level matching costs nothing per sample.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include "DeviceProfiles.h"
+
+// Normalised (a0 == 1) biquad coefficients. Defaults to a unity pass-through.
+// Kept in double so the double precision path gets the full design; the float path rounds once on load.
+struct BiquadCoefficients
+{
+    double b0 { 1.0 }, b1 { 0.0 }, b2 { 0.0 }, a1 { 0.0 }, a2 { 0.0 };
+};
+
+using ProfileCoefficients = std::array<BiquadCoefficients, numBands>;
+
+// Topology-preserving state variable filter (Simper) parameters. Output is m0 * in + m1 * band + m2 * low.
+// The structure stays stable for any g > 0 and k > 0, so these can be interpolated freely between profiles.
+struct SvfCoefficients
+{
+    double g { 0.1 }, k { 1.0 }, m0 { 1.0 }, m1 { 0.0 }, m2 { 0.0 };
+};
+
+using SvfProfile = std::array<SvfCoefficients, numBands>;
+
+class CoefficientBank
+{
+public:
+    // Rebuilds every profile, but only if the sample rate actually changed.
+    // Call from prepareToPlay, never from the audio thread.
+    void prepare (double newSampleRate);
+
+    const ProfileCoefficients& getProfile (Device device) const noexcept
+    {
+        return profiles[static_cast<size_t>(device)];
+    }
+
+    const SvfProfile& getSvfProfile (Device device) const noexcept
+    {
+        return svfProfiles[static_cast<size_t>(device)];
+    }
+
+    // The same curves with the compensation gain folded into the last section.
+    const ProfileCoefficients& getMatchedProfile (Device device) const noexcept
+    {
+        return matchedProfiles[static_cast<size_t>(device)];
+    }
+
+    const SvfProfile& getMatchedSvfProfile (Device device) const noexcept
+    {
+        return matchedSvfProfiles[static_cast<size_t>(device)];
+    }
+
+    // How long a profile rings after its input stops, in samples at the bank's rate.
+    int getTailSamples (Device device) const noexcept
+    {
+        return tailSamples[static_cast<size_t>(device)];
+    }
+
+    int getMaximumTailSamples() const noexcept
+    {
+        return *std::max_element (tailSamples.begin(), tailSamples.end());
+    }
+
+    // Linear gain that brings a profile's pink-noise level back to that of the input.
+    double getCompensationGain (Device device) const noexcept
+    {
+        return compensationGains[static_cast<size_t>(device)];
+    }
+
+    double getSampleRate() const noexcept { return sampleRate; }
+
+    // Combined magnitude of all five sections of a profile at each frequency (in Hz).
+    void getMagnitudeForFrequencyArray (Device device, const double* frequencies, double* magnitudes, size_t numFrequencies) const noexcept;
+
+    // The same for any set of sections running at 'rate', such as a matched copy or a blend of SVF profiles.
+    static void getMagnitudeForFrequencyArray (const ProfileCoefficients& profile, double rate, const double* frequencies,
+                                               double* magnitudes, size_t numFrequencies) noexcept;
+    static void getMagnitudeForFrequencyArray (const SvfProfile& profile, double rate, const double* frequencies,
+                                               double* magnitudes, size_t numFrequencies) noexcept;
+
+private:
+    static BiquadCoefficients design (const Band& band, double sampleRate);
+    static SvfCoefficients designSvf (const Band& band, double sampleRate);
+    double measurePinkGain (Device device) const noexcept;
+    static int measureTail (const ProfileCoefficients& profile) noexcept;
+
+    double sampleRate { 0.0 };
+    std::array<ProfileCoefficients, numDevices> profiles {};
+    std::array<SvfProfile, numDevices> svfProfiles {};
+    std::array<ProfileCoefficients, numDevices> matchedProfiles {};
+    std::array<SvfProfile, numDevices> matchedSvfProfiles {};
+    std::array<double, numDevices> compensationGains {};
+    std::array<int, numDevices> tailSamples {};
+};
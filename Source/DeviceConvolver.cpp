@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+    DeviceConvolver.cpp
+
+  ==============================================================================
+*/
+
+#include "DeviceConvolver.h"
+
+DeviceConvolver::DeviceConvolver (const juce::String& threadName) : juce::Thread (threadName)
+{
+}
+
+DeviceConvolver::~DeviceConvolver()
+{
+    // A derived class forgot to call stopKernelThread(), so loadDevice may have been running on a dead object.
+    jassert (! isThreadRunning());
+    stopThread (2000);
+}
+
+void DeviceConvolver::prepare (double newSampleRate, int numChannels, int maximumBlockSize)
+{
+    const juce::ScopedLock sl (lifecycleLock);
+
+    ready.store (false);
+    stopThread (2000);
+
+    sampleRate = newSampleRate;
+    spec.sampleRate = sampleRate;
+    spec.maximumBlockSize = static_cast<juce::uint32>(maximumBlockSize);
+    spec.numChannels = 2;
+
+    headSize = juce::nextPowerOfTwo (juce::jmax (maximumBlockSize, 32));
+    numPairs = (numChannels + 1) / 2;
+
+    convolutions.clear();
+}
+
+void DeviceConvolver::setEnabled (bool shouldBeEnabled)
+{
+    const juce::ScopedLock sl (lifecycleLock);
+
+    if (! shouldBeEnabled)
+    {
+        ready.store (false);
+        stopThread (2000);
+        return;
+    }
+
+    if (ready.load() || sampleRate <= 0.0)
+        return;
+
+    // The audio thread leaves the engines alone until 'ready' is set, so building them here is safe.
+    if (convolutions.empty())
+    {
+        for (int pair = 0; pair < numPairs; ++pair)
+        {
+            auto convolution = std::make_unique<juce::dsp::Convolution> (juce::dsp::Convolution::NonUniform { headSize }, messageQueue.getObject());
+            convolution->prepare (spec);
+            convolutions.push_back (std::move (convolution));
+        }
+
+        prepareConvolutions (sampleRate);
+    }
+
+    startThread();
+    ready.store (true, std::memory_order_release);
+}
+
+void DeviceConvolver::reset()
+{
+    if (! isReady())
+        return;
+
+    for (auto& convolution : convolutions)
+        convolution->reset();
+}
+
+void DeviceConvolver::process (const juce::dsp::AudioBlock<float>& block, Device device) noexcept
+{
+    requestedDevice.store (static_cast<int>(device), std::memory_order_relaxed);
+
+    auto numChannels = block.getNumChannels();
+
+    for (size_t pair = 0; pair < convolutions.size() && pair * 2 < numChannels; ++pair)
+    {
+        auto channels = block.getSubsetChannelBlock (pair * 2, juce::jmin (static_cast<size_t>(2), numChannels - pair * 2));
+        convolutions[pair]->process (juce::dsp::ProcessContextReplacing<float> (channels));
+    }
+}
+
+void DeviceConvolver::wakeForRequestedDevice()
+{
+    if (isReady() && requestedDevice.load (std::memory_order_relaxed) != loadedDevice.load (std::memory_order_relaxed))
+        notify();
+}
+
+void DeviceConvolver::loadKernel (const juce::AudioBuffer<float>& kernel, double kernelSampleRate)
+{
+    for (auto& convolution : convolutions)
+    {
+        auto copy = kernel;
+        convolution->loadImpulseResponse (std::move (copy), kernelSampleRate, juce::dsp::Convolution::Stereo::yes,
+                                          juce::dsp::Convolution::Trim::no, juce::dsp::Convolution::Normalise::no);
+    }
+}
+
+void DeviceConvolver::run()
+{
+    prepareKernels (sampleRate);
+    loadedDevice.store (-1, std::memory_order_relaxed);
+
+    while (! threadShouldExit())
+    {
+        auto device = requestedDevice.load (std::memory_order_relaxed);
+
+        if (device >= 0 && device != loadedDevice.load (std::memory_order_relaxed))
+        {
+            loadDevice (static_cast<Device>(device));
+            loadedDevice.store (device, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Sleeps until wakeForRequestedDevice() sees another device asked for, or stopThread() wakes it to exit.
+        wait (-1);
+    }
+}
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    DeviceConvolver.h
+
+    Shared plumbing for the convolution based renderers: one zero-latency
+    juce::dsp::Convolution per channel pair, plus a background thread that
+    loads a new kernel whenever the audio thread asks for another device.
+
+    Nothing is built until the renderer is switched on, so an instance that
+    never uses it costs no memory and no thread. Every instance loads its
+    kernels through the same process-wide message queue.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include "DeviceProfiles.h"
+
+class DeviceConvolver  : private juce::Thread
+{
+public:
+    explicit DeviceConvolver (const juce::String& threadName);
+    ~DeviceConvolver() override;
+
+    // Not realtime safe: stops the kernel thread, drops the convolution engines and leaves the renderer
+    // switched off until the next setEnabled (true).
+    void prepare (double newSampleRate, int numChannels, int maximumBlockSize);
+
+    // Message thread or prepareToPlay, never the audio thread. Switching on builds the engines the first
+    // time after a prepare and starts the kernel thread; switching off stops the thread but keeps the
+    // engines, which the audio thread may still be finishing a block with.
+    // The head partition follows the host block size, so small buffers don't pay for long kernels.
+    void setEnabled (bool shouldBeEnabled);
+
+    // True once the engines exist and the kernel thread is running; until then process() must not be called.
+    bool isReady() const noexcept { return ready.load (std::memory_order_acquire); }
+
+    void reset();
+
+    // Runs the kernel for 'device'. A device change is only recorded here; the convolution crossfades to
+    // the new kernel once the kernel thread has loaded it.
+    void process (const juce::dsp::AudioBlock<float>& block, Device device) noexcept;
+
+    // Message thread: wakes the kernel thread if process() has asked for a device it hasn't loaded yet.
+    // Waking a thread takes a lock, so the audio thread leaves this to whoever polls it.
+    void wakeForRequestedDevice();
+
+protected:
+    // Caller of setEnabled: called once the engines exist, before the kernel thread starts.
+    virtual void prepareConvolutions (double newSampleRate) { juce::ignoreUnused (newSampleRate); }
+
+    // Kernel thread: called every time the thread starts, before any loadDevice call.
+    virtual void prepareKernels (double newSampleRate) { juce::ignoreUnused (newSampleRate); }
+
+    // Kernel thread: load whatever 'device' should sound like via loadKernel/getConvolutions.
+    virtual void loadDevice (Device device) = 0;
+
+    // Derived classes must call this from their destructor, before their own members go away.
+    void stopKernelThread() { stopThread (2000); }
+
+    void loadKernel (const juce::AudioBuffer<float>& kernel, double kernelSampleRate);
+    const std::vector<std::unique_ptr<juce::dsp::Convolution>>& getConvolutions() const noexcept { return convolutions; }
+    double getSampleRate() const noexcept { return sampleRate; }
+
+private:
+    void run() override;
+
+    juce::SharedResourcePointer<juce::dsp::ConvolutionMessageQueue> messageQueue;
+    std::vector<std::unique_ptr<juce::dsp::Convolution>> convolutions;   // one per channel pair
+    juce::dsp::ProcessSpec spec {};
+    int headSize { 0 }, numPairs { 0 };
+    double sampleRate { 0.0 };
+
+    juce::CriticalSection lifecycleLock;   // prepare and setEnabled can come from different threads
+    std::atomic<bool> ready { false };
+    std::atomic<int> requestedDevice { -1 }, loadedDevice { -1 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DeviceConvolver)
+};
@@ -0,0 +1,240 @@
+/*
+  ==============================================================================
+
+    DeviceEngine.h
+
+    Runs the device cascade and handles switching between profiles. A switch
+    spins up a second chain with fresh state for the new profile and
+    crossfades into it; outside of a transition only one chain runs.
+
+    In morph mode the biquad chains are swapped for an SVF cascade whose
+    parameters glide between two profiles. Entering or leaving morph mode is
+    crossfaded the same way as a device switch.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include "BiquadCascade.h"
+#include "SvfCascade.h"
+
+template <typename SampleType>
+class DeviceEngine
+{
+public:
+    explicit DeviceEngine (const CoefficientBank& bankToUse) : bank (bankToUse) {}
+
+    void prepare (double newSampleRate, int numChannels, int maximumBlockSize)
+    {
+        sampleRate = newSampleRate;
+
+        for (auto& chain : chains)
+            chain.prepare (numChannels, maximumBlockSize);
+
+        morphCascade.prepare (sampleRate, numChannels);
+
+        fadeBuffer.setSize (numChannels, maximumBlockSize);
+        modeFadeBuffer.setSize (numChannels, maximumBlockSize);
+        setCrossfadeTime (crossfadeMs);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& chain : chains)
+            chain.reset();
+
+        morphCascade.reset();
+
+        fadePosition = fadeLength;
+        modeFadePosition = fadeLength;
+        currentDevice = Device::numDevices;
+        modeKnown = false;
+    }
+
+    void setCrossfadeTime (float milliseconds) noexcept
+    {
+        crossfadeMs = milliseconds;
+        fadeLength = juce::jmax (0, static_cast<int>(sampleRate * milliseconds * 0.001));
+    }
+
+    bool isCrossfading() const noexcept { return fadePosition < fadeLength || modeFadePosition < fadeLength; }
+
+    // Uses the bank's loudness-matched curves. A change is crossfaded like a device switch.
+    void setLoudnessMatched (bool shouldMatch) noexcept { matched = shouldMatch; }
+
+    // Renders a single device profile.
+    void process (const juce::dsp::AudioBlock<SampleType>& block, Device device) noexcept
+    {
+        setMorphing (false);
+
+        if (device != currentDevice || matched != loadedMatched)
+            switchTo (device);
+
+        render (block);
+    }
+
+    // Renders a blend of two profiles, amount 0 being all of 'from' and 1 all of 'to'.
+    void processMorph (const juce::dsp::AudioBlock<SampleType>& block, Device from, Device to, SampleType amount) noexcept
+    {
+        setMorphing (true);
+
+        if (matched)
+            morphCascade.setTarget (bank.getMatchedSvfProfile (from), bank.getMatchedSvfProfile (to), amount);
+        else
+            morphCascade.setTarget (bank.getSvfProfile (from), bank.getSvfProfile (to), amount);
+
+        render (block);
+    }
+
+private:
+    void setMorphing (bool shouldMorph) noexcept
+    {
+        if (modeKnown && shouldMorph == morphing)
+            return;
+
+        // The path we're entering always starts from clean state.
+        if (shouldMorph)
+        {
+            morphCascade.reset();
+        }
+        else
+        {
+            for (auto& chain : chains)
+                chain.reset();
+
+            currentDevice = Device::numDevices;
+        }
+
+        modeFadePosition = modeKnown ? 0 : fadeLength;
+        morphing = shouldMorph;
+        modeKnown = true;
+    }
+
+    void switchTo (Device device) noexcept
+    {
+        auto firstProfile = currentDevice == Device::numDevices;
+        auto& profile = matched ? bank.getMatchedProfile (device) : bank.getProfile (device);
+        currentDevice = device;
+        loadedMatched = matched;
+
+        if (firstProfile || fadeLength == 0)
+        {
+            chains[active].setProfile (profile);
+            fadePosition = fadeLength;
+            return;
+        }
+
+        // The chain we were listening to (even if it was itself fading in) becomes the outgoing one,
+        // and the idle chain starts from clean state so it never sees the old curve's history.
+        active ^= 1;
+        chains[active].reset();
+        chains[active].setProfile (profile);
+        fadePosition = 0;
+    }
+
+    void render (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        auto numSamples = static_cast<int>(block.getNumSamples());
+        auto done = 0;
+
+        while (modeFadePosition < fadeLength && done < numSamples)
+        {
+            auto chunkLength = juce::jmin (numSamples - done, modeFadeBuffer.getNumSamples());
+            auto chunk = block.getSubBlock (static_cast<size_t>(done), static_cast<size_t>(chunkLength));
+            auto outgoing = copyToScratch (chunk, modeFadeBuffer);
+
+            renderPath (outgoing, ! morphing);
+            renderPath (chunk, morphing);
+            modeFadePosition = crossfade (chunk, outgoing, modeFadePosition, fadeLength);
+            done += chunkLength;
+        }
+
+        if (done < numSamples)
+            renderPath (block.getSubBlock (static_cast<size_t>(done), static_cast<size_t>(numSamples - done)), morphing);
+    }
+
+    void renderPath (const juce::dsp::AudioBlock<SampleType>& block, bool morphPath) noexcept
+    {
+        if (morphPath)
+            morphCascade.process (block);
+        else
+            renderChains (block);
+    }
+
+    void renderChains (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        auto numSamples = static_cast<int>(block.getNumSamples());
+        auto done = 0;
+
+        // Crossfade in chunks that fit the scratch buffer; whatever is left after the fade is single-chain.
+        while (fadePosition < fadeLength && done < numSamples)
+        {
+            auto chunkLength = juce::jmin (numSamples - done, fadeBuffer.getNumSamples());
+            auto chunk = block.getSubBlock (static_cast<size_t>(done), static_cast<size_t>(chunkLength));
+            auto outgoing = copyToScratch (chunk, fadeBuffer);
+
+            chains[active ^ 1].process (outgoing);
+            chains[active].process (chunk);
+            fadePosition = crossfade (chunk, outgoing, fadePosition, fadeLength);
+            done += chunkLength;
+        }
+
+        if (done < numSamples)
+            chains[active].process (block.getSubBlock (static_cast<size_t>(done), static_cast<size_t>(numSamples - done)));
+    }
+
+    static juce::dsp::AudioBlock<SampleType> copyToScratch (const juce::dsp::AudioBlock<SampleType>& block,
+                                                            juce::AudioBuffer<SampleType>& scratch) noexcept
+    {
+        auto numChannels = juce::jmin (block.getNumChannels(), static_cast<size_t>(scratch.getNumChannels()));
+        auto copy = juce::dsp::AudioBlock<SampleType> (scratch).getSubsetChannelBlock (0, numChannels)
+                                                               .getSubBlock (0, block.getNumSamples());
+        copy.copyFrom (block);
+        return copy;
+    }
+
+    // Linear fade from 'outgoing' into 'block' (in place), returning the new fade position.
+    static int crossfade (const juce::dsp::AudioBlock<SampleType>& block, const juce::dsp::AudioBlock<SampleType>& outgoing,
+                          int position, int length) noexcept
+    {
+        auto fadeSamples = juce::jmin (static_cast<int>(block.getNumSamples()), length - position);
+        auto step = static_cast<SampleType>(1) / static_cast<SampleType>(length);
+
+        for (size_t channel = 0; channel < outgoing.getNumChannels(); ++channel)
+        {
+            auto* in = block.getChannelPointer (channel);
+            auto* out = outgoing.getChannelPointer (channel);
+            auto gain = static_cast<SampleType>(position) * step;
+
+            for (int i = 0; i < fadeSamples; ++i)
+            {
+                in[i] = out[i] + gain * (in[i] - out[i]);
+                gain += step;
+            }
+        }
+
+        return position + fadeSamples;
+    }
+
+    const CoefficientBank& bank;
+
+    std::array<BiquadCascade<SampleType>, 2> chains;
+    size_t active { 0 };
+    Device currentDevice { Device::numDevices };
+    bool matched { false };
+    bool loadedMatched { false };
+
+    SvfCascade<SampleType> morphCascade;
+    bool morphing { false };
+    bool modeKnown { false };
+
+    juce::AudioBuffer<SampleType> fadeBuffer, modeFadeBuffer;
+    double sampleRate { 44100.0 };
+    float crossfadeMs { 20.f };
+    int fadeLength { 0 };
+    int fadePosition { 0 };
+    int modeFadePosition { 0 };
+};
@@ -0,0 +1,155 @@
+/*
+  ==============================================================================
+
+    DeviceProfiles.h
+
+    Every device curve QwikRef can emulate, as plain data. Adding a device is
+    one row in deviceProfiles (plus its entry in the Device enum).
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+enum class Device
+{
+    car,
+    laptop,
+    phone,
+    tv,
+    airpods,
+    btSpeaker,
+    flat,
+    numDevices
+};
+
+constexpr int numDevices = static_cast<int>(Device::numDevices);
+constexpr int numBands = 5;
+
+enum class BandType
+{
+    bypass,
+    highPass,
+    lowPass,
+    lowShelf,
+    highShelf,
+    peak
+};
+
+struct Band
+{
+    BandType type { BandType::bypass };
+    float frequency { 1000.f };
+    float q { 0.71f };
+    float gainDb { 0.f };
+};
+
+struct DeviceProfile
+{
+    Device device;
+    const char* parameterID;   // empty for profiles without a toggle (flat)
+    const char* name;
+    bool defaultOn;
+    std::array<Band, numBands> bands;
+};
+
+// makeHighPass/makeLowPass in juce use a Butterworth Q, mirrored here so the table stays exact.
+constexpr float butterworthQ = 0.70710678f;
+
+constexpr std::array<DeviceProfile, numDevices> deviceProfiles
+{{
+    { Device::car, "car", "Car", true,
+      {{ { BandType::lowShelf,  100.f,   .71f,  5.f },
+         { BandType::peak,      625.f,   .71f, -5.f },
+         { BandType::peak,      1600.f,  .71f, -5.f },
+         { BandType::peak,      4000.f,  .71f,  5.f },
+         { BandType::highShelf, 10000.f, .71f, 10.f } }} },
+
+    { Device::laptop, "laptop", "Laptop", false,
+      {{ { BandType::highPass,  300.f,   butterworthQ, 0.f },
+         { BandType::peak,      700.f,   1.f,  10.f },
+         { BandType::peak,      2000.f,  .5f,  -5.f },
+         { BandType::peak,      6000.f,  .3f,   5.f },
+         { BandType::highShelf, 10000.f, .71f, -5.f } }} },
+
+    { Device::phone, "phone", "Phone", false,
+      {{ { BandType::highPass,  800.f,   butterworthQ, 0.f },
+         { BandType::peak,      1000.f,  .71f,  5.f },
+         { BandType::peak,      3000.f,  .71f,  8.f },
+         { BandType::peak,      7500.f,  .71f, 10.f },
+         { BandType::lowPass,   12000.f, butterworthQ, 0.f } }} },
+
+    { Device::tv, "tv", "TV", false,
+      {{ { BandType::highPass,  100.f,   butterworthQ, 0.f },
+         { BandType::peak,      300.f,   .71f,  10.f },
+         { BandType::peak,      2250.f,  .71f,  -2.5f },
+         { BandType::peak,      10000.f, .71f, -10.f },
+         { BandType::lowPass,   15000.f, butterworthQ, 0.f } }} },
+
+    { Device::airpods, "airpods", "Airpods", false,
+      {{ { BandType::highPass,  100.f,   butterworthQ, 0.f },
+         { BandType::peak,      200.f,   .4f,  2.5f },
+         { BandType::peak,      2000.f,  .71f, 5.f },
+         { BandType::peak,      10000.f, 2.f,  5.f },
+         { BandType::lowPass,   15000.f, butterworthQ, 0.f } }} },
+
+    { Device::btSpeaker, "btSpeaker", "BT Speaker", false,
+      {{ { BandType::highPass,  60.f,    butterworthQ, 0.f },
+         { BandType::peak,      100.f,   2.f,  -15.f },
+         { BandType::peak,      300.f,   .4f,   2.5f },
+         { BandType::peak,      2500.f,  .3f,  -2.5f },
+         { BandType::highShelf, 10000.f, .71f, -2.5f } }} },
+
+    { Device::flat, "", "Flat", false, {} }
+}};
+
+constexpr const DeviceProfile& getDeviceProfile (Device device)
+{
+    return deviceProfiles[static_cast<size_t>(device)];
+}
+
+constexpr bool hasParameter (const DeviceProfile& profile)
+{
+    return profile.parameterID[0] != '\0';
+}
+
+namespace ProfileValidation
+{
+    // Everything has to stay designable at 44.1 kHz, the lowest rate we support.
+    constexpr float maxFrequency = 20000.f;
+
+    constexpr bool isValid (const Band& band)
+    {
+        if (band.type == BandType::bypass)
+            return true;
+
+        if (band.frequency <= 0.f || band.frequency >= maxFrequency || band.q <= 0.f)
+            return false;
+
+        // Gain only means something for shelves and peaks.
+        if ((band.type == BandType::highPass || band.type == BandType::lowPass) && band.gainDb != 0.f)
+            return false;
+
+        return band.gainDb > -40.f && band.gainDb < 40.f;
+    }
+
+    constexpr bool isValid()
+    {
+        for (size_t i = 0; i < deviceProfiles.size(); ++i)
+        {
+            if (deviceProfiles[i].device != static_cast<Device>(i))
+                return false;
+
+            for (auto& band : deviceProfiles[i].bands)
+                if (! isValid (band))
+                    return false;
+        }
+
+        return true;
+    }
+}
+
+static_assert (ProfileValidation::isValid(), "deviceProfiles has a bad row, or rows are out of Device order");
@@ -0,0 +1,196 @@
+/*
+  ==============================================================================
+
+    FanOutEngine.h
+
+    Renders every device profile from one input pass. Each input channel is
+    broadcast into the SIMD lanes of a single BiquadCascade, one lane per
+    device, so all chains stay warm and any of them can be monitored or sent
+    to its own output bus without re-buffering.
+
+    The lanes always run the plain curves. Loudness matching is a gain per
+    device on the outputs, ramped so switching it never steps the level of
+    the monitor or any device bus.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include "BiquadCascade.h"
+
+template <typename SampleType>
+class FanOutEngine
+{
+public:
+    explicit FanOutEngine (const CoefficientBank& bankToUse) : bank (bankToUse) {}
+
+    void prepare (double newSampleRate, int numChannelsToUse, int maximumBlockSize)
+    {
+        sampleRate = newSampleRate;
+        numChannels = numChannelsToUse;
+
+        auto numLanes = numChannels * numDevices;
+
+        // Lanes run channel-major, so one SIMD group holds several devices of the same channel,
+        // while deviceOutputs is stored device-major so each device's channels are contiguous.
+        cascade.prepare (numLanes, maximumBlockSize);
+        deviceOutputs.setSize (numLanes, maximumBlockSize);
+        inputPointers.resize (static_cast<size_t>(numLanes));
+        outputPointers.resize (static_cast<size_t>(numLanes));
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int device = 0; device < numDevices; ++device)
+                outputPointers[static_cast<size_t>(channel * numDevices + device)] = deviceOutputs.getWritePointer (device * numChannels + channel);
+
+        loadProfiles();
+
+        for (auto& gain : compensation)
+            gain.reset (sampleRate, 0.05);
+
+        setMonitorFadeTime (fadeMs);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        cascade.reset();
+        monitor = Device::numDevices;
+        fadePosition = fadeLength;
+
+        for (int device = 0; device < numDevices; ++device)
+            compensation[static_cast<size_t>(device)].setCurrentAndTargetValue (getCompensationTarget (static_cast<Device>(device)));
+    }
+
+    void setMonitorFadeTime (float milliseconds) noexcept
+    {
+        fadeMs = milliseconds;
+        fadeLength = juce::jmax (0, static_cast<int>(sampleRate * milliseconds * 0.001));
+    }
+
+    // Ramps every device's output, device buses included, to or from its loudness compensation.
+    void setLoudnessMatched (bool shouldMatch) noexcept
+    {
+        if (shouldMatch == matched)
+            return;
+
+        matched = shouldMatch;
+
+        for (int device = 0; device < numDevices; ++device)
+            compensation[static_cast<size_t>(device)].setTargetValue (getCompensationTarget (static_cast<Device>(device)));
+    }
+
+    // Renders every device, then writes the monitored one back into block.
+    void process (const juce::dsp::AudioBlock<SampleType>& block, Device deviceToMonitor) noexcept
+    {
+        jassert (block.getNumSamples() <= static_cast<size_t>(deviceOutputs.getNumSamples()));
+
+        auto numSamples = juce::jmin (block.getNumSamples(), static_cast<size_t>(deviceOutputs.getNumSamples()));
+        auto channelsToUse = juce::jmin (static_cast<int>(block.getNumChannels()), numChannels);
+
+        for (int channel = 0; channel < channelsToUse; ++channel)
+            for (int device = 0; device < numDevices; ++device)
+                inputPointers[static_cast<size_t>(channel * numDevices + device)] = block.getChannelPointer (static_cast<size_t>(channel));
+
+        auto lanes = static_cast<size_t>(channelsToUse * numDevices);
+        cascade.process (juce::dsp::AudioBlock<SampleType> (inputPointers.data(), lanes, numSamples),
+                         juce::dsp::AudioBlock<SampleType> (outputPointers.data(), lanes, numSamples));
+
+        for (int device = 0; device < numDevices; ++device)
+            applyCompensation (static_cast<Device>(device), numSamples, channelsToUse);
+
+        if (deviceToMonitor != monitor)
+        {
+            previousMonitor = monitor;
+            monitor = deviceToMonitor;
+            fadePosition = previousMonitor == Device::numDevices ? fadeLength : 0;
+        }
+
+        auto output = block.getSubsetChannelBlock (0, static_cast<size_t>(channelsToUse)).getSubBlock (0, numSamples);
+        output.copyFrom (getDeviceOutput (monitor, numSamples));
+
+        // The chains are all warm, so a monitor switch only needs a short fade between two outputs we already have.
+        if (fadePosition < fadeLength)
+        {
+            auto outgoing = getDeviceOutput (previousMonitor, numSamples);
+            auto fadeSamples = juce::jmin (static_cast<int>(numSamples), fadeLength - fadePosition);
+            auto step = static_cast<SampleType>(1) / static_cast<SampleType>(fadeLength);
+
+            for (size_t channel = 0; channel < output.getNumChannels(); ++channel)
+            {
+                auto* in = output.getChannelPointer (channel);
+                auto* out = outgoing.getChannelPointer (channel);
+                auto gain = static_cast<SampleType>(fadePosition) * step;
+
+                for (int i = 0; i < fadeSamples; ++i)
+                {
+                    in[i] = out[i] + gain * (in[i] - out[i]);
+                    gain += step;
+                }
+            }
+
+            fadePosition += fadeSamples;
+        }
+    }
+
+    // The last block rendered for a device, valid until the next process() call.
+    juce::dsp::AudioBlock<SampleType> getDeviceOutput (Device device, size_t numSamples) noexcept
+    {
+        return juce::dsp::AudioBlock<SampleType> (deviceOutputs)
+                   .getSubsetChannelBlock (static_cast<size_t>(static_cast<int>(device) * numChannels), static_cast<size_t>(numChannels))
+                   .getSubBlock (0, numSamples);
+    }
+
+private:
+    void loadProfiles() noexcept
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int device = 0; device < numDevices; ++device)
+                cascade.setProfile (channel * numDevices + device, bank.getProfile (static_cast<Device>(device)));
+    }
+
+    SampleType getCompensationTarget (Device device) const noexcept
+    {
+        return matched ? static_cast<SampleType>(bank.getCompensationGain (device)) : static_cast<SampleType>(1);
+    }
+
+    // Folding the gain into the lanes' coefficients would step it, with the filter state still scaled for the old
+    // gain, so it goes on the outputs instead: a ramp while it changes, one multiply per sample while matched.
+    void applyCompensation (Device device, size_t numSamples, int channelsToUse) noexcept
+    {
+        auto& gain = compensation[static_cast<size_t>(device)];
+        auto output = getDeviceOutput (device, numSamples).getSubsetChannelBlock (0, static_cast<size_t>(channelsToUse));
+
+        if (gain.isSmoothing())
+        {
+            for (size_t i = 0; i < numSamples; ++i)
+            {
+                auto g = gain.getNextValue();
+
+                for (size_t channel = 0; channel < output.getNumChannels(); ++channel)
+                    output.getChannelPointer (channel)[i] *= g;
+            }
+        }
+        else if (gain.getCurrentValue() != static_cast<SampleType>(1))
+        {
+            output.multiplyBy (gain.getCurrentValue());
+        }
+    }
+
+    const CoefficientBank& bank;
+    bool matched { false };
+    std::array<juce::SmoothedValue<SampleType>, numDevices> compensation;
+
+    BiquadCascade<SampleType> cascade;
+    juce::AudioBuffer<SampleType> deviceOutputs;
+    std::vector<SampleType*> inputPointers, outputPointers;
+
+    double sampleRate { 44100.0 };
+    int numChannels { 0 };
+
+    Device monitor { Device::numDevices }, previousMonitor { Device::numDevices };
+    float fadeMs { 20.f };
+    int fadeLength { 0 };
+    int fadePosition { 0 };
+};
@@ -0,0 +1,111 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseEngine.h"
+
+LinearPhaseEngine::LinearPhaseEngine() : DeviceConvolver ("QwikRef FIR designer")
+{
+}
+
+LinearPhaseEngine::~LinearPhaseEngine()
+{
+    stopKernelThread();
+}
+
+int LinearPhaseEngine::getKernelLength (double sampleRate)
+{
+    // ~170 ms of taps is what it takes to hold the 100 Hz Q2 notch within a dB at any rate.
+    return juce::nextPowerOfTwo (static_cast<int>(sampleRate * 0.17));
+}
+
+void LinearPhaseEngine::prepareConvolutions (double newSampleRate)
+{
+    auto kernelLength = getKernelLength (newSampleRate);
+
+    // Until the real kernels arrive, run a pure delay so the reported latency is already honoured.
+    juce::AudioBuffer<float> delay (2, kernelLength);
+    delay.clear();
+    delay.setSample (0, kernelLength / 2, 1.f);
+    delay.setSample (1, kernelLength / 2, 1.f);
+    loadKernel (delay, newSampleRate);
+}
+
+void LinearPhaseEngine::prepareKernels (double newSampleRate)
+{
+    // Designing under the lock means a second instance at the same rate waits for the first one's
+    // kernels instead of designing its own copy.
+    const juce::ScopedLock sl (cache->lock);
+    auto& kernelSet = cache->kernelSets[newSampleRate];
+
+    if (kernelSet == nullptr)
+        kernelSet = designKernels (newSampleRate);
+
+    kernels = kernelSet;
+}
+
+void LinearPhaseEngine::loadDevice (Device device)
+{
+    loadKernel ((*kernels)[static_cast<size_t>(device)], getSampleRate());
+}
+
+std::shared_ptr<const LinearPhaseEngine::KernelSet> LinearPhaseEngine::designKernels (double rate)
+{
+    CoefficientBank bank;
+    bank.prepare (rate);
+
+    auto length = getKernelLength (rate);
+    auto order = juce::roundToInt (std::log2 (length));
+    juce::dsp::FFT fft (order);
+
+    std::vector<double> frequencies (static_cast<size_t>(length / 2 + 1)), magnitudes (frequencies.size());
+
+    for (size_t bin = 0; bin < frequencies.size(); ++bin)
+        frequencies[bin] = rate * static_cast<double>(bin) / length;
+
+    std::vector<juce::dsp::Complex<float>> spectrum (static_cast<size_t>(length)), impulse (spectrum.size());
+
+    // The FFT's inverse scaling differs between backends, so measure it once with a flat spectrum.
+    std::fill (spectrum.begin(), spectrum.end(), juce::dsp::Complex<float> (1.f, 0.f));
+    fft.perform (spectrum.data(), impulse.data(), true);
+    auto inverseScale = 1.f / impulse[0].real();
+
+    auto kernels = std::make_shared<KernelSet>();
+
+    for (auto& row : deviceProfiles)
+    {
+        bank.getMagnitudeForFrequencyArray (row.device, frequencies.data(), magnitudes.data(), magnitudes.size());
+
+        // Zero-phase magnitude, delayed by half the kernel: (-1)^k is a shift of length / 2 samples.
+        for (size_t bin = 0; bin < magnitudes.size(); ++bin)
+        {
+            auto value = static_cast<float>((bin % 2 == 0) ? magnitudes[bin] : -magnitudes[bin]);
+            spectrum[bin] = { value, 0.f };
+
+            if (bin > 0 && bin < static_cast<size_t>(length) - bin)
+                spectrum[static_cast<size_t>(length) - bin] = { value, 0.f };
+        }
+
+        fft.perform (spectrum.data(), impulse.data(), true);
+
+        auto& kernel = (*kernels)[static_cast<size_t>(row.device)];
+        kernel.setSize (2, length);
+
+        for (int i = 0; i < length; ++i)
+        {
+            // Periodic Blackman window, symmetric about the centre tap.
+            auto phase = juce::MathConstants<double>::twoPi * i / length;
+            auto window = 0.42 - 0.5 * std::cos (phase) + 0.08 * std::cos (2.0 * phase);
+            auto tap = static_cast<float>(impulse[static_cast<size_t>(i)].real() * inverseScale * window);
+
+            kernel.setSample (0, i, tap);
+            kernel.setSample (1, i, tap);
+        }
+    }
+
+    return kernels;
+}
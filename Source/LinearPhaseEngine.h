@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.h
+
+    Linear-phase rendering of the device curves. Each profile's magnitude
+    response is turned into a symmetric FIR on the kernel thread and convolved
+    with zero added latency. The FIR's centre tap sets the reported latency.
+    Kernel sets are designed once per sample rate and shared by every
+    instance in the process.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "DeviceConvolver.h"
+#include "CoefficientBank.h"
+
+class LinearPhaseEngine  : public DeviceConvolver
+{
+public:
+    LinearPhaseEngine();
+    ~LinearPhaseEngine() override;
+
+    // Known from prepare() on, whether or not the engine has been switched on yet.
+    int getLatencySamples() const noexcept { return getSampleRate() > 0.0 ? getKernelLength (getSampleRate()) / 2 : 0; }
+
+    // The latency (N/2) plus the N/2 taps after the centre one that are still ringing: the whole kernel.
+    int getTailSamples() const noexcept { return getSampleRate() > 0.0 ? getKernelLength (getSampleRate()) : 0; }
+
+    static int getKernelLength (double sampleRate);
+
+    using KernelSet = std::array<juce::AudioBuffer<float>, numDevices>;
+
+    // Designs every profile's FIR at the given rate. Safe to call from any thread.
+    static std::shared_ptr<const KernelSet> designKernels (double sampleRate);
+
+private:
+    void prepareConvolutions (double newSampleRate) override;
+    void prepareKernels (double newSampleRate) override;
+    void loadDevice (Device device) override;
+
+    struct KernelCache
+    {
+        juce::CriticalSection lock;
+        std::map<double, std::shared_ptr<const KernelSet>> kernelSets;
+    };
+
+    juce::SharedResourcePointer<KernelCache> cache;
+    std::shared_ptr<const KernelSet> kernels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LinearPhaseEngine)
+};
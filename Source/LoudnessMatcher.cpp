@@ -0,0 +1,41 @@
+/*
+  ==============================================================================
+
+    LoudnessMatcher.cpp
+
+  ==============================================================================
+*/
+
+#include "LoudnessMatcher.h"
+
+void LoudnessMatcher::prepare (const juce::AudioChannelSet& layout, double sampleRate)
+{
+    input.prepare (layout, sampleRate);
+    rendered.prepare (layout, sampleRate);
+    output.prepare (layout, sampleRate);
+    gain.reset (sampleRate, 0.05);
+    reset();
+}
+
+void LoudnessMatcher::reset() noexcept
+{
+    input.reset();
+    rendered.reset();
+    output.reset();
+    gain.setCurrentAndTargetValue (1.0);
+    dynamicGain = 0.f;
+    measuring = outputWasMetered = false;
+    appliedGain.store (0.f);
+}
+
+float LoudnessMatcher::updateDynamicGain() noexcept
+{
+    auto in = input.getShortTerm();
+    auto out = rendered.getShortTerm();
+
+    // Hold the last gain through silence rather than chasing the noise floor.
+    if (in > LoudnessMeter::absoluteGate && out > LoudnessMeter::absoluteGate)
+        dynamicGain = juce::jlimit (-maxGainDecibels, maxGainDecibels, in - out);
+
+    return dynamicGain;
+}
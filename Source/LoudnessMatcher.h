@@ -0,0 +1,113 @@
+/*
+  ==============================================================================
+
+    LoudnessMatcher.h
+
+    Level-matches the device profiles, so switching between them compares
+    tone rather than loudness. Dynamic matching follows the short-term
+    loudness difference between the input and the rendered signal. Static
+    matching is mostly done by the cascades themselves, which load the
+    bank's pink-compensated curves; paths that don't run the cascades pass
+    the compensation in here instead. Either way the gain ramps, so a device
+    switch never steps the level.
+
+    The input and rendered meters only run while dynamic matching needs
+    them, and the output meter only while the editor is showing it.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "LoudnessMeter.h"
+
+enum class LoudnessMatch { off, staticCurve, dynamic };
+
+class LoudnessMatcher
+{
+public:
+    void prepare (const juce::AudioChannelSet& layout, double sampleRate);
+    void reset() noexcept;
+
+    // Any thread: the editor turns the output meter on while it is open.
+    void setOutputMetered (bool shouldMeter) noexcept { outputMetered.store (shouldMeter, std::memory_order_relaxed); }
+
+    template <typename SampleType>
+    void measureInput (const juce::dsp::AudioBlock<SampleType>& block, LoudnessMatch mode) noexcept
+    {
+        // Meters that sat idle start afresh, so dynamic matching never chases loudness from before it was on.
+        auto dynamic = mode == LoudnessMatch::dynamic;
+
+        if (dynamic && ! measuring)
+        {
+            input.reset();
+            rendered.reset();
+            dynamicGain = 0.f;
+        }
+
+        measuring = dynamic;
+
+        if (measuring)
+            input.process (block);
+    }
+
+    // Measures the rendered block, then applies the gain for the mode, ramped from where the last block left off.
+    template <typename SampleType>
+    void apply (const juce::dsp::AudioBlock<SampleType>& block, LoudnessMatch mode, float staticGainDecibels) noexcept
+    {
+        if (measuring)
+            rendered.process (block);
+
+        auto targetDecibels = 0.f;
+
+        if (mode == LoudnessMatch::staticCurve)
+            targetDecibels = staticGainDecibels;
+        else if (mode == LoudnessMatch::dynamic)
+            targetDecibels = updateDynamicGain();
+
+        gain.setTargetValue (juce::Decibels::decibelsToGain (static_cast<double>(targetDecibels)));
+
+        if (gain.isSmoothing())
+        {
+            for (size_t i = 0; i < block.getNumSamples(); ++i)
+            {
+                auto g = static_cast<SampleType>(gain.getNextValue());
+
+                for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+                    block.getChannelPointer (channel)[i] *= g;
+            }
+        }
+        else if (gain.getCurrentValue() != 1.0)
+        {
+            block.multiplyBy (static_cast<SampleType>(gain.getCurrentValue()));
+        }
+
+        appliedGain.store (static_cast<float>(juce::Decibels::gainToDecibels (gain.getCurrentValue())), std::memory_order_relaxed);
+
+        auto metered = outputMetered.load (std::memory_order_relaxed);
+
+        if (metered && ! outputWasMetered)
+            output.reset();
+
+        outputWasMetered = metered;
+
+        if (metered)
+            output.process (block);
+    }
+
+    const LoudnessMeter& getOutputMeter() const noexcept { return output; }
+    float getAppliedGainDecibels() const noexcept { return appliedGain.load (std::memory_order_relaxed); }
+
+private:
+    float updateDynamicGain() noexcept;
+
+    static constexpr float maxGainDecibels = 24.f;
+
+    LoudnessMeter input, rendered, output;
+
+    juce::SmoothedValue<double> gain { 1.0 };
+    float dynamicGain { 0.f };
+    bool measuring { false }, outputWasMetered { false };
+    std::atomic<bool> outputMetered { false };
+    std::atomic<float> appliedGain { 0.f };
+};
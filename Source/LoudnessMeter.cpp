@@ -0,0 +1,175 @@
+/*
+  ==============================================================================
+
+    LoudnessMeter.cpp
+
+  ==============================================================================
+*/
+
+#include "LoudnessMeter.h"
+
+namespace
+{
+    float powerToLufs (double power) noexcept
+    {
+        return power > 0.0 ? static_cast<float>(-0.691 + 10.0 * std::log10 (power))
+                           : -std::numeric_limits<float>::infinity();
+    }
+
+    double channelWeight (juce::AudioChannelSet::ChannelType type) noexcept
+    {
+        using Set = juce::AudioChannelSet;
+
+        switch (type)
+        {
+            case Set::LFE:
+            case Set::LFE2:
+                return 0.0;
+
+            case Set::leftSurround:
+            case Set::rightSurround:
+            case Set::leftSurroundSide:
+            case Set::rightSurroundSide:
+            case Set::leftSurroundRear:
+            case Set::rightSurroundRear:
+            case Set::centreSurround:
+                return 1.41;
+
+            default:
+                return 1.0;
+        }
+    }
+}
+
+void LoudnessMeter::prepare (const juce::AudioChannelSet& layout, double sampleRate)
+{
+    // The BS.1770 K-weighting filters, re-derived from their analogue prototypes for any sample rate.
+    auto shelf = [sampleRate]
+    {
+        const auto f0 = 1681.974450955533, gainDb = 3.999843853973347, q = 0.7071752369554196;
+        auto k = std::tan (juce::MathConstants<double>::pi * f0 / sampleRate);
+        auto vh = std::pow (10.0, gainDb / 20.0);
+        auto vb = std::pow (vh, 0.4996667741545416);
+        auto a0 = 1.0 + k / q + k * k;
+
+        Biquad b;
+        b.b0 = (vh + vb * k / q + k * k) / a0;
+        b.b1 = 2.0 * (k * k - vh) / a0;
+        b.b2 = (vh - vb * k / q + k * k) / a0;
+        b.a1 = 2.0 * (k * k - 1.0) / a0;
+        b.a2 = (1.0 - k / q + k * k) / a0;
+        return b;
+    }();
+
+    auto highPass = [sampleRate]
+    {
+        const auto f0 = 38.13547087602444, q = 0.5003270373238773;
+        auto k = std::tan (juce::MathConstants<double>::pi * f0 / sampleRate);
+        auto a0 = 1.0 + k / q + k * k;
+
+        Biquad b;
+        b.b0 = 1.0;
+        b.b1 = -2.0;
+        b.b2 = 1.0;
+        b.a1 = 2.0 * (k * k - 1.0) / a0;
+        b.a2 = (1.0 - k / q + k * k) / a0;
+        return b;
+    }();
+
+    channels.clear();
+
+    for (int channel = 0; channel < layout.size(); ++channel)
+        channels.push_back ({ shelf, highPass, channelWeight (layout.getTypeOfChannel (channel)) });
+
+    stepLength = juce::jmax (1, juce::roundToInt (sampleRate * 0.1));
+    reset();
+}
+
+void LoudnessMeter::reset() noexcept
+{
+    for (auto& channel : channels)
+    {
+        channel.shelf.s1 = channel.shelf.s2 = 0.0;
+        channel.highPass.s1 = channel.highPass.s2 = 0.0;
+    }
+
+    stepFill = 0;
+    stepEnergy = 0.0;
+    steps.fill (0.0);
+    stepIndex = 0;
+    stepsFilled = 0;
+    binEnergy.fill (0.0);
+    binCount.fill (0);
+
+    momentary.store (-std::numeric_limits<float>::infinity());
+    shortTerm.store (-std::numeric_limits<float>::infinity());
+    integrated.store (-std::numeric_limits<float>::infinity());
+}
+
+void LoudnessMeter::finishStep() noexcept
+{
+    steps[stepIndex] = stepEnergy / stepLength;
+    stepIndex = (stepIndex + 1) % steps.size();
+    stepsFilled = juce::jmin (stepsFilled + 1, steps.size());
+    stepEnergy = 0.0;
+    stepFill = 0;
+
+    auto average = [this] (size_t count)
+    {
+        auto sum = 0.0;
+
+        for (size_t i = 1; i <= count; ++i)
+            sum += steps[(stepIndex + steps.size() - i) % steps.size()];
+
+        return sum / static_cast<double>(count);
+    };
+
+    auto momentaryPower = average (juce::jmin (stepsFilled, stepsPerMomentary));
+    momentary.store (powerToLufs (momentaryPower), std::memory_order_relaxed);
+    shortTerm.store (powerToLufs (average (stepsFilled)), std::memory_order_relaxed);
+
+    // Each 100 ms step completes a 400 ms gating block overlapping the last by 75%.
+    if (stepsFilled < stepsPerMomentary)
+        return;
+
+    auto loudness = powerToLufs (momentaryPower);
+
+    if (loudness <= absoluteGate)
+        return;
+
+    auto bin = juce::jlimit (0, numBins - 1, static_cast<int>((loudness - absoluteGate) * 10.f));
+    binEnergy[static_cast<size_t>(bin)] += momentaryPower;
+    ++binCount[static_cast<size_t>(bin)];
+
+    integrated.store (computeIntegrated(), std::memory_order_relaxed);
+}
+
+float LoudnessMeter::computeIntegrated() const noexcept
+{
+    auto totalEnergy = 0.0;
+    auto totalCount = 0.0;
+
+    for (size_t bin = 0; bin < binEnergy.size(); ++bin)
+    {
+        totalEnergy += binEnergy[bin];
+        totalCount += binCount[bin];
+    }
+
+    if (totalCount == 0.0)
+        return -std::numeric_limits<float>::infinity();
+
+    // Relative gate: drop every block more than 10 LU below the absolute-gated loudness.
+    auto relativeGate = powerToLufs (totalEnergy / totalCount) - 10.f;
+    auto firstBin = juce::jlimit (0, numBins, static_cast<int>(std::ceil ((relativeGate - absoluteGate) * 10.f)));
+
+    auto gatedEnergy = 0.0;
+    auto gatedCount = 0.0;
+
+    for (auto bin = static_cast<size_t>(firstBin); bin < binEnergy.size(); ++bin)
+    {
+        gatedEnergy += binEnergy[bin];
+        gatedCount += binCount[bin];
+    }
+
+    return gatedCount > 0.0 ? powerToLufs (gatedEnergy / gatedCount) : -std::numeric_limits<float>::infinity();
+}
@@ -0,0 +1,107 @@
+/*
+  ==============================================================================
+
+    LoudnessMeter.h
+
+    ITU-R BS.1770 loudness, measured incrementally on the audio thread.
+    Samples go through the K-weighting filters and are summed into 100 ms
+    steps; momentary (400 ms) and short-term (3 s) loudness come from the
+    last 4 and 30 steps, and every momentary block feeds a 0.1 LU histogram
+    that gives the gated integrated loudness without storing any history.
+
+    Readings are published as atomics, so the editor can show them at any
+    time.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+class LoudnessMeter
+{
+public:
+    // Allocates per-channel filters for the layout; the LFE is left out of the sum, surrounds are weighted up.
+    void prepare (const juce::AudioChannelSet& layout, double sampleRate);
+    void reset() noexcept;
+
+    template <typename SampleType>
+    void process (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        auto numChannels = juce::jmin (block.getNumChannels(), channels.size());
+
+        for (size_t i = 0; i < block.getNumSamples(); ++i)
+        {
+            auto sum = 0.0;
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                auto& c = channels[channel];
+
+                if (c.weight == 0.0)
+                    continue;
+
+                auto x = c.highPass.process (c.shelf.process (static_cast<double>(block.getChannelPointer (channel)[i])));
+                sum += c.weight * x * x;
+            }
+
+            stepEnergy += sum;
+
+            if (++stepFill == stepLength)
+                finishStep();
+        }
+    }
+
+    // In LUFS; minus infinity until there is something to measure.
+    float getMomentary() const noexcept   { return momentary.load (std::memory_order_relaxed); }
+    float getShortTerm() const noexcept   { return shortTerm.load (std::memory_order_relaxed); }
+    float getIntegrated() const noexcept  { return integrated.load (std::memory_order_relaxed); }
+
+    static constexpr float absoluteGate = -70.f;
+
+private:
+    struct Biquad
+    {
+        double b0 { 1.0 }, b1 { 0.0 }, b2 { 0.0 }, a1 { 0.0 }, a2 { 0.0 };
+        double s1 { 0.0 }, s2 { 0.0 };
+
+        double process (double x) noexcept
+        {
+            auto y = b0 * x + s1;
+            s1 = b1 * x - a1 * y + s2;
+            s2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    struct Channel
+    {
+        Biquad shelf, highPass;
+        double weight { 1.0 };
+    };
+
+    void finishStep() noexcept;
+    float computeIntegrated() const noexcept;
+
+    static constexpr size_t stepsPerMomentary = 4;
+    static constexpr size_t stepsPerShortTerm = 30;
+    static constexpr int numBins = 750;   // -70 to +5 LUFS in 0.1 LU steps
+
+    std::vector<Channel> channels;
+
+    int stepLength { 4410 };
+    int stepFill { 0 };
+    double stepEnergy { 0.0 };
+
+    std::array<double, stepsPerShortTerm> steps {};
+    size_t stepIndex { 0 };
+    size_t stepsFilled { 0 };
+
+    std::array<double, numBins> binEnergy {};
+    std::array<juce::uint32, numBins> binCount {};
+
+    std::atomic<float> momentary { -std::numeric_limits<float>::infinity() };
+    std::atomic<float> shortTerm { -std::numeric_limits<float>::infinity() };
+    std::atomic<float> integrated { -std::numeric_limits<float>::infinity() };
+};
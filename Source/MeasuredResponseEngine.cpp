@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    MeasuredResponseEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "MeasuredResponseEngine.h"
+#include "BinaryData.h"
+
+MeasuredResponseEngine::MeasuredResponseEngine() : DeviceConvolver ("QwikRef IR loader")
+{
+}
+
+MeasuredResponseEngine::~MeasuredResponseEngine()
+{
+    stopKernelThread();
+}
+
+juce::File MeasuredResponseEngine::getUserImpulseResponseFolder()
+{
+    return juce::File::getSpecialLocation (juce::File::userApplicationDataDirectory)
+               .getChildFile ("KiTiK Music")
+               .getChildFile ("QwikRef")
+               .getChildFile ("IRs");
+}
+
+void MeasuredResponseEngine::prepareConvolutions (double newSampleRate)
+{
+    juce::ignoreUnused (newSampleRate);
+    loadedLength.store (0);
+}
+
+// Kernel thread, each time the engine is switched on: the file system is no place for the message thread.
+void MeasuredResponseEngine::prepareKernels (double newSampleRate)
+{
+    juce::ignoreUnused (newSampleRate);
+
+    for (auto& profile : deviceProfiles)
+    {
+        int size = 0;
+        auto found = hasParameter (profile) && (findUserFile (profile).existsAsFile() || findBinaryResource (profile, size) != nullptr);
+        available[static_cast<size_t>(profile.device)].store (found, std::memory_order_release);
+    }
+}
+
+void MeasuredResponseEngine::loadDevice (Device device)
+{
+    if (! hasImpulseResponse (device))
+        return;
+
+    auto response = getImpulseResponse (getDeviceProfile (device));
+
+    if (response == nullptr)
+        return;
+
+    // Measured IRs come at all sorts of levels, so let the convolution normalise them.
+    for (auto& convolution : getConvolutions())
+    {
+        auto copy = response->buffer;
+        convolution->loadImpulseResponse (std::move (copy), response->sampleRate, juce::dsp::Convolution::Stereo::yes,
+                                          juce::dsp::Convolution::Trim::yes, juce::dsp::Convolution::Normalise::yes);
+    }
+
+    // Trimming can only make it shorter, so the untrimmed length is a safe tail.
+    loadedLength.store (static_cast<int>(std::ceil (response->buffer.getNumSamples() * getSampleRate() / response->sampleRate)),
+                        std::memory_order_relaxed);
+}
+
+MeasuredResponseEngine::ImpulseResponseCache::ImpulseResponseCache()
+{
+    formatManager.registerBasicFormats();
+}
+
+// Kernel thread. Decodes the IR the first time any instance asks for it; a user file that has been
+// saved again since is decoded afresh.
+std::shared_ptr<const MeasuredResponseEngine::ImpulseResponse> MeasuredResponseEngine::getImpulseResponse (const DeviceProfile& profile)
+{
+    auto file = findUserFile (profile);
+    int size = 0;
+    auto* resource = file.existsAsFile() ? nullptr : findBinaryResource (profile, size);
+
+    if (! file.existsAsFile() && resource == nullptr)
+        return {};
+
+    auto key = resource != nullptr ? juce::String (profile.parameterID)
+                                   : file.getFullPathName() + ":" + juce::String (file.getLastModificationTime().toMilliseconds());
+
+    const juce::ScopedLock sl (cache->lock);
+    auto& response = cache->responses[key];
+
+    if (response != nullptr)
+        return response;
+
+    std::unique_ptr<juce::AudioFormatReader> reader (resource != nullptr
+        ? cache->formatManager.createReaderFor (std::make_unique<juce::MemoryInputStream> (resource, static_cast<size_t>(size), false))
+        : cache->formatManager.createReaderFor (file));
+
+    if (reader == nullptr || reader->lengthInSamples <= 0)
+        return {};
+
+    auto decoded = std::make_shared<ImpulseResponse>();
+    decoded->sampleRate = reader->sampleRate;
+    decoded->buffer.setSize (juce::jmin (2, static_cast<int>(reader->numChannels)), static_cast<int>(reader->lengthInSamples));
+    reader->read (&decoded->buffer, 0, decoded->buffer.getNumSamples(), 0, true, true);
+
+    response = decoded;
+    return response;
+}
+
+juce::File MeasuredResponseEngine::findUserFile (const DeviceProfile& profile)
+{
+    auto folder = getUserImpulseResponseFolder();
+
+    for (auto* extension : { ".wav", ".aiff", ".aif", ".flac" })
+    {
+        auto file = folder.getChildFile (juce::String (profile.parameterID) + extension);
+
+        if (file.existsAsFile())
+            return file;
+    }
+
+    return {};
+}
+
+const char* MeasuredResponseEngine::findBinaryResource (const DeviceProfile& profile, int& size)
+{
+    // juce_add_binary_data names resources after the file, e.g. Assets/car.wav -> car_wav.
+    for (auto* suffix : { "_wav", "_aiff", "_aif", "_flac" })
+        if (auto* data = BinaryData::getNamedResource ((juce::String (profile.parameterID) + suffix).toRawUTF8(), size))
+            return data;
+
+    return nullptr;
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    MeasuredResponseEngine.h
+
+    Renders devices from measured impulse responses instead of the biquad
+    approximations. An IR named after the device's parameter ID (car.wav,
+    phone.aiff, ...) is looked up in the user IR folder first, then in the
+    Assets binary data. Devices with no IR fall back to the biquad chain.
+    Each IR is decoded once per process and shared by every instance.
+
+    No IRs ship in Assets, so on a stock install every device falls back
+    and the measured switch changes nothing until IRs are added to the
+    folder. The folder is scanned again each time the switch is turned on.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "DeviceConvolver.h"
+
+class MeasuredResponseEngine  : public DeviceConvolver
+{
+public:
+    MeasuredResponseEngine();
+    ~MeasuredResponseEngine() override;
+
+    // Every time the engine is switched on, the kernel thread rescans the IR folder and binary data before it
+    // loads anything, so an IR dropped in while the switch was off is picked up. Until that scan has found a
+    // device's IR, the device stays on the biquads.
+    bool hasImpulseResponse (Device device) const noexcept
+    {
+        return available[static_cast<size_t>(device)].load (std::memory_order_acquire);
+    }
+
+    // The length of the IR loaded last, at the host rate: how long the output rings after the input stops.
+    int getTailSamples() const noexcept { return loadedLength.load (std::memory_order_relaxed); }
+
+    static juce::File getUserImpulseResponseFolder();
+
+private:
+    void prepareConvolutions (double newSampleRate) override;
+    void prepareKernels (double newSampleRate) override;
+    void loadDevice (Device device) override;
+
+    struct ImpulseResponse
+    {
+        juce::AudioBuffer<float> buffer;
+        double sampleRate { 0.0 };
+    };
+
+    struct ImpulseResponseCache
+    {
+        ImpulseResponseCache();
+
+        juce::CriticalSection lock;
+        juce::AudioFormatManager formatManager;
+        std::map<juce::String, std::shared_ptr<const ImpulseResponse>> responses;   // by file and modification time, or resource
+    };
+
+    std::shared_ptr<const ImpulseResponse> getImpulseResponse (const DeviceProfile& profile);
+
+    static juce::File findUserFile (const DeviceProfile& profile);
+    static const char* findBinaryResource (const DeviceProfile& profile, int& size);
+
+    juce::SharedResourcePointer<ImpulseResponseCache> cache;
+    std::array<std::atomic<bool>, numDevices> available {};
+    std::atomic<int> loadedLength { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeasuredResponseEngine)
+};
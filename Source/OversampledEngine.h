@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    OversampledEngine.h
+
+    Runs the device cascade at 2x or 4x the host rate, so shelves and peaks
+    near Nyquist keep the shape they have in the analogue prototypes instead
+    of being cramped by the bilinear transform.
+
+    Every factor has its own coefficient bank and DeviceEngine, and every
+    factor/quality pair has its own juce::dsp::Oversampling, all built in
+    prepare() so switching on the audio thread never allocates.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include "DeviceEngine.h"
+
+enum class OversamplingQuality
+{
+    lowCpu,      // polyphase IIR half-bands, relaxed specs
+    balanced,    // polyphase IIR half-bands, tight specs
+    linearPhase, // equiripple FIR half-bands, most latency
+    numQualities
+};
+
+template <typename SampleType>
+class OversampledEngine
+{
+public:
+    using Quality = OversamplingQuality;
+
+    // Index 0 of the "oversampling" parameter is off, so factors start at 1.
+    static constexpr int numFactors = 2;
+    static constexpr int numQualities = static_cast<int>(Quality::numQualities);
+
+    void prepare (double newSampleRate, int numChannels, int maximumBlockSize)
+    {
+        maxBlockSize = maximumBlockSize;
+
+        for (size_t i = 0; i < stages.size(); ++i)
+        {
+            auto& stage = stages[i];
+            auto order = i + 1;
+            auto factor = 1 << static_cast<int>(order);
+
+            stage.bank.prepare (newSampleRate * factor);
+            stage.engine.prepare (newSampleRate * factor, numChannels, maximumBlockSize * factor);
+
+            for (int quality = 0; quality < numQualities; ++quality)
+            {
+                auto fir = static_cast<Quality>(quality) == Quality::linearPhase;
+                auto maxQuality = static_cast<Quality>(quality) != Quality::lowCpu;
+
+                auto& oversampler = stage.oversamplers[static_cast<size_t>(quality)];
+                oversampler = std::make_unique<juce::dsp::Oversampling<SampleType>> (
+                    static_cast<size_t>(numChannels), order,
+                    fir ? juce::dsp::Oversampling<SampleType>::filterHalfBandFIREquiripple
+                        : juce::dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR,
+                    maxQuality, true);
+                oversampler->initProcessing (static_cast<size_t>(maximumBlockSize));
+            }
+        }
+
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& stage : stages)
+        {
+            stage.engine.reset();
+
+            for (auto& oversampler : stage.oversamplers)
+                if (oversampler != nullptr)
+                    oversampler->reset();
+        }
+
+        currentSetting = -1;
+    }
+
+    void setCrossfadeTime (float milliseconds) noexcept
+    {
+        for (auto& stage : stages)
+            stage.engine.setCrossfadeTime (milliseconds);
+    }
+
+    void setLoudnessMatched (bool shouldMatch) noexcept
+    {
+        for (auto& stage : stages)
+            stage.engine.setLoudnessMatched (shouldMatch);
+    }
+
+    // Round trip latency at the host rate, for factor 1 (2x) or 2 (4x).
+    int getLatencySamples (int factor, Quality quality) const noexcept
+    {
+        auto& oversampler = getStage (factor).oversamplers[static_cast<size_t>(quality)];
+        return oversampler != nullptr ? static_cast<int>(oversampler->getLatencyInSamples()) : 0;
+    }
+
+    // How long the output keeps going after the input stops, at the host rate: the slowest profile's
+    // ring-out at the oversampled rate, plus the half-bands' delay and their own ringing. The FIR
+    // half-bands are symmetric, so they ring for as long again after their delay; the IIR ones settle
+    // sooner than that, which leaves them some margin.
+    int getTailSamples (int factor, Quality quality) const noexcept
+    {
+        auto& stage = getStage (factor);
+        auto cascadeTail = stage.bank.getMaximumTailSamples() >> juce::jlimit (1, numFactors, factor);
+        return cascadeTail + 2 * getLatencySamples (factor, quality);
+    }
+
+    int getMaximumLatencySamples() const noexcept
+    {
+        auto latency = 0;
+
+        for (int factor = 1; factor <= numFactors; ++factor)
+            for (int quality = 0; quality < numQualities; ++quality)
+                latency = juce::jmax (latency, getLatencySamples (factor, static_cast<Quality>(quality)));
+
+        return latency;
+    }
+
+    void process (const juce::dsp::AudioBlock<SampleType>& block, int factor, Quality quality, Device device) noexcept
+    {
+        render (block, factor, quality, [device] (auto& engine, auto& upsampled) { engine.process (upsampled, device); });
+    }
+
+    void processMorph (const juce::dsp::AudioBlock<SampleType>& block, int factor, Quality quality,
+                       Device from, Device to, SampleType amount) noexcept
+    {
+        render (block, factor, quality, [=] (auto& engine, auto& upsampled) { engine.processMorph (upsampled, from, to, amount); });
+    }
+
+private:
+    struct Stage
+    {
+        CoefficientBank bank;
+        DeviceEngine<SampleType> engine { bank };
+        std::array<std::unique_ptr<juce::dsp::Oversampling<SampleType>>, numQualities> oversamplers;
+    };
+
+    Stage& getStage (int factor) noexcept { return stages[static_cast<size_t>(juce::jlimit (1, numFactors, factor) - 1)]; }
+    const Stage& getStage (int factor) const noexcept { return stages[static_cast<size_t>(juce::jlimit (1, numFactors, factor) - 1)]; }
+
+    template <typename Renderer>
+    void render (const juce::dsp::AudioBlock<SampleType>& block, int factor, Quality quality, Renderer&& renderer) noexcept
+    {
+        auto& stage = getStage (factor);
+        auto& oversampler = stage.oversamplers[static_cast<size_t>(quality)];
+
+        if (oversampler == nullptr)
+            return;
+
+        // A new factor or filter starts from clean state; its delay lines hold nothing we've played.
+        auto key = factor * numQualities + static_cast<int>(quality);
+
+        if (key != currentSetting)
+        {
+            stage.engine.reset();
+            oversampler->reset();
+            currentSetting = key;
+        }
+
+        // The oversampler was sized for the prepared block, so longer host blocks go through in pieces.
+        for (size_t start = 0; start < block.getNumSamples(); start += static_cast<size_t>(maxBlockSize))
+        {
+            auto chunk = block.getSubBlock (start, juce::jmin (block.getNumSamples() - start, static_cast<size_t>(maxBlockSize)));
+            auto upsampled = oversampler->processSamplesUp (chunk);
+
+            renderer (stage.engine, upsampled);
+            oversampler->processSamplesDown (chunk);
+        }
+    }
+
+    std::array<Stage, numFactors> stages;
+    int maxBlockSize { 0 };
+    int currentSetting { -1 };
+};
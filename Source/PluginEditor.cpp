@@ -15,7 +15,10 @@ QwikRefAudioProcessorEditor::QwikRefAudioProcessorEditor (QwikRefAudioProcessor&
     carAT(p.apvts, "car", car), laptopAT(p.apvts, "laptop", laptop),
     phoneAT(p.apvts, "phone", phone), tvAT(p.apvts, "tv", tv),
     airpodsAT(p.apvts, "airpods", airpods), speakerAT(p.apvts, "btSpeaker", speaker),
-    powerAT(p.apvts, "power", power)
+    powerAT(p.apvts, "power", power), analyzer(p.getAnalyzer(), [&p] { return p.getResponseSettings(); }, p.getLoudnessMatcher()),
+    profiler(p.getProfiler()),
+    titleFont(juce::Typeface::createSystemTypefaceFor(BinaryData::offshore_ttf, BinaryData::offshore_ttfSize)),
+    logo(juce::ImageCache::getFromMemory(BinaryData::KITIK_LOGO_NO_BKGD_png, BinaryData::KITIK_LOGO_NO_BKGD_pngSize))
 {
 
     setLookAndFeel(&lnf);
@@ -45,6 +48,10 @@ QwikRefAudioProcessorEditor::QwikRefAudioProcessorEditor (QwikRefAudioProcessor&
     addAndMakeVisible(power);
 
     addAndMakeVisible(gumroad);
+    addAndMakeVisible(analyzer);
+    addChildComponent(profiler);
+
+    profiler.onCollapse = [this] { setProfilerVisible(false); };
 
     juce::PropertiesFile::Options options;
     options.applicationName = "QwikRef";
@@ -60,12 +67,18 @@ QwikRefAudioProcessorEditor::QwikRefAudioProcessorEditor (QwikRefAudioProcessor&
                                    orgWidth * 4, orgHeight * 4);
     }
 
-    auto sizeRatio{1.0};
+    auto useOpenGL{false};
+    auto showProfiler{false};
     if (auto *properties = appProperties.getCommonSettings(true))
     {
         sizeRatio = properties->getDoubleValue("sizeRatio", 1.0);
+        useOpenGL = properties->getBoolValue("useOpenGL", false);
+        showProfiler = properties->getBoolValue("showProfiler", false);
     }
 
+    setOpenGLEnabled(useOpenGL);
+    profiler.setVisible(showProfiler);
+
     setResizable(true, true);
     setSize(static_cast<int>(orgWidth * sizeRatio),
             static_cast<int>(orgHeight * sizeRatio));
@@ -73,17 +86,36 @@ QwikRefAudioProcessorEditor::QwikRefAudioProcessorEditor (QwikRefAudioProcessor&
 
 QwikRefAudioProcessorEditor::~QwikRefAudioProcessorEditor()
 {
+    // A resize that hasn't been written yet still counts.
+    if (isTimerRunning())
+        saveSizeRatio();
+
+   #if JUCE_MODULE_AVAILABLE_juce_opengl
+    openGLContext.detach();
+   #endif
+
     setLookAndFeel(nullptr);
 }
 
 //==============================================================================
 void QwikRefAudioProcessorEditor::paint (juce::Graphics& g)
 {
-    auto sizeRatio{1.0};
-    if (auto *properties = appProperties.getCommonSettings(true))
-    {
-        sizeRatio = properties->getDoubleValue("sizeRatio", 1.0);
-    }
+    auto pixelScale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    if (background.isNull() || pixelScale != backgroundScale)
+        renderBackground(pixelScale);
+
+    g.drawImage(background, getLocalBounds().toFloat());
+}
+
+void QwikRefAudioProcessorEditor::renderBackground (float pixelScale)
+{
+    background = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt(getWidth() * pixelScale)),
+                             juce::jmax(1, juce::roundToInt(getHeight() * pixelScale)), false);
+    backgroundScale = pixelScale;
+
+    juce::Graphics g(background);
+    g.addTransform(juce::AffineTransform::scale(pixelScale));
 
     g.fillAll (juce::Colours::black);
 
@@ -91,6 +123,7 @@ void QwikRefAudioProcessorEditor::paint (juce::Graphics& g)
     g.setFont (15.0f);
 
     auto bounds = juce::Rectangle<int>{orgWidth, orgHeight};
+    bounds.removeFromBottom(analyzerHeight);
 
     auto infoArea = bounds.removeFromTop(30);
     infoArea.setWidth(infoArea.getWidth()*sizeRatio);
@@ -113,9 +146,14 @@ void QwikRefAudioProcessorEditor::paint (juce::Graphics& g)
     logoBackdrop.setWidth(logoBackdrop.getWidth() * sizeRatio);
     logoBackdrop.setHeight(logoBackdrop.getHeight() * sizeRatio);
     logoBackdrop.setTop(30*sizeRatio);
-    logoBackdrop.setBottom(orgHeight * sizeRatio);
+    logoBackdrop.setBottom((orgHeight - analyzerHeight) * sizeRatio);
+
+    juce::Path analyzerDivider;
+    analyzerDivider.startNewSubPath(0, (orgHeight - analyzerHeight) * sizeRatio);
+    analyzerDivider.lineTo(200 * sizeRatio, (orgHeight - analyzerHeight) * sizeRatio);
+    g.strokePath(analyzerDivider, juce::PathStrokeType(1));
 
-    auto newFont = juce::Font(juce::Typeface::createSystemTypefaceFor(BinaryData::offshore_ttf, BinaryData::offshore_ttfSize));
+    auto newFont = titleFont;
 
     newFont.setHeight(25*sizeRatio);
     g.setFont(newFont);
@@ -123,8 +161,7 @@ void QwikRefAudioProcessorEditor::paint (juce::Graphics& g)
     newFont.setHeight(12*sizeRatio);
     g.setFont(newFont);
     g.drawFittedText("By KiTiK Music", logoBackdrop.toNearestInt(), juce::Justification::Justification::centredTop, 1);
-    
-    auto logo = juce::ImageCache::getFromMemory(BinaryData::KITIK_LOGO_NO_BKGD_png, BinaryData::KITIK_LOGO_NO_BKGD_pngSize); 
+
     g.setOpacity(.3f);
     g.drawImage(logo, logoBackdrop.toFloat(), juce::RectanglePlacement::stretchToFit);
     g.setOpacity(1);
@@ -133,15 +170,18 @@ void QwikRefAudioProcessorEditor::paint (juce::Graphics& g)
 void QwikRefAudioProcessorEditor::resized()
 {
     const auto scaleFactor = static_cast<float>(getWidth()) / orgWidth;
-    if (auto *properties = appProperties.getCommonSettings(true))
-    {
-        properties->setValue("sizeRatio", scaleFactor);
-    }
+    sizeRatio = scaleFactor;
+    background = {};
+
+    // Dragging the corner resizes many times a second; only the size it settles on gets written.
+    startTimer(500);
 
     //auto bounds = getLocalBounds();
     auto bounds = juce::Rectangle<int>{orgWidth, orgHeight};
+    auto analyzerArea = bounds.removeFromBottom(analyzerHeight);
 
     auto infoArea = bounds.removeFromTop(30);
+    auto profilerArea = bounds;
     auto powerArea = infoArea.removeFromLeft(infoArea.getWidth() * .15);
     auto linkSpace = infoArea.removeFromRight(infoArea.getWidth() * .2);
 
@@ -161,6 +201,8 @@ void QwikRefAudioProcessorEditor::resized()
     speaker.setTransform(juce::AffineTransform::scale(scaleFactor));
     power.setTransform(juce::AffineTransform::scale(scaleFactor));
     gumroad.setTransform(juce::AffineTransform::scale(scaleFactor));
+    analyzer.setTransform(juce::AffineTransform::scale(scaleFactor));
+    profiler.setTransform(juce::AffineTransform::scale(scaleFactor));
 
     car.setBounds(leftTop);
     laptop.setBounds(top);
@@ -169,9 +211,76 @@ void QwikRefAudioProcessorEditor::resized()
     airpods.setBounds(leftLow);
     speaker.setBounds(low);
     power.setBounds(powerArea);
+    analyzer.setBounds(analyzerArea);
+    profiler.setBounds(profilerArea);
 
     auto font = juce::Font(10);
     gumroad.setFont(font, false);
     gumroad.setColour(0x1001f00, juce::Colours::white);
     gumroad.setBounds(linkSpace);
 }
+
+void QwikRefAudioProcessorEditor::mouseDown (const juce::MouseEvent& event)
+{
+    if (! event.mods.isPopupMenu())
+        return;
+
+    juce::PopupMenu menu;
+
+   #if JUCE_MODULE_AVAILABLE_juce_opengl
+    menu.addItem("GPU rendering (OpenGL)", true, openGLContext.isAttached(), [this]
+    {
+        auto enable = ! openGLContext.isAttached();
+        setOpenGLEnabled(enable);
+
+        if (auto *properties = appProperties.getCommonSettings(true))
+            properties->setValue("useOpenGL", enable);
+    });
+   #endif
+
+    menu.addItem("Performance", true, profiler.isVisible(), [this] { setProfilerVisible(! profiler.isVisible()); });
+
+    menu.showMenuAsync(juce::PopupMenu::Options().withMousePosition());
+}
+
+void QwikRefAudioProcessorEditor::setOpenGLEnabled (bool shouldBeEnabled)
+{
+   #if JUCE_MODULE_AVAILABLE_juce_opengl
+    if (shouldBeEnabled == openGLContext.isAttached())
+        return;
+
+    if (shouldBeEnabled)
+        openGLContext.attachTo(*this);
+    else
+        openGLContext.detach();
+
+    // The cached background was rendered for the old renderer's pixel scale.
+    background = {};
+    repaint();
+   #else
+    juce::ignoreUnused(shouldBeEnabled);
+   #endif
+}
+
+void QwikRefAudioProcessorEditor::setProfilerVisible (bool shouldBeVisible)
+{
+    profiler.setVisible(shouldBeVisible);
+
+    if (auto *properties = appProperties.getCommonSettings(true))
+        properties->setValue("showProfiler", shouldBeVisible);
+}
+
+void QwikRefAudioProcessorEditor::timerCallback()
+{
+    stopTimer();
+    saveSizeRatio();
+}
+
+void QwikRefAudioProcessorEditor::saveSizeRatio()
+{
+    if (auto *properties = appProperties.getCommonSettings(true))
+    {
+        properties->setValue("sizeRatio", sizeRatio);
+        properties->saveIfNeeded();
+    }
+}
@@ -12,11 +12,18 @@
 #include "BinaryData.h"
 #include "juce_core/juce_core.h"
 #include "kLookAndFeel.h"
+#include "AnalyzerComponent.h"
+#include "ProfilerComponent.h"
+
+#if JUCE_MODULE_AVAILABLE_juce_opengl
+ #include <juce_opengl/juce_opengl.h>
+#endif
 
 //==============================================================================
 /**
 */
-class QwikRefAudioProcessorEditor  : public juce::AudioProcessorEditor
+class QwikRefAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                     private juce::Timer
 {
 public:
     QwikRefAudioProcessorEditor (QwikRefAudioProcessor&);
@@ -25,8 +32,15 @@ public:
     //==============================================================================
     void paint (juce::Graphics&) override;
     void resized() override;
+    void mouseDown (const juce::MouseEvent&) override;
 
 private:
+    void timerCallback() override;
+    void renderBackground (float pixelScale);
+    void saveSizeRatio();
+    void setOpenGLEnabled (bool shouldBeEnabled);
+    void setProfilerVisible (bool shouldBeVisible);
+
     // This reference is provided as a quick way for your editor to
     // access the processor object that created it.
     QwikRefAudioProcessor& audioProcessor;
@@ -34,6 +48,12 @@ private:
     Laf lnf;
     juce::Array<juce::Font> fonts;
 
+    // Built once; the background (text, dividers and logo) is only re-rendered when the size or display scale changes.
+    juce::Font titleFont;
+    juce::Image logo, background;
+    float backgroundScale{0.f};
+    double sizeRatio{1.0};
+
     juce::URL url{ "https://kwhaley5.gumroad.com/" };
 
     juce::HyperlinkButton gumroad{ "Plugins", url };
@@ -41,9 +61,19 @@ private:
     juce::ToggleButton car, laptop, phone, tv, airpods, speaker, power;
     juce::AudioProcessorValueTreeState::ButtonAttachment carAT, laptopAT, phoneAT, tvAT, airpodsAT, speakerAT, powerAT;
 
+    AnalyzerComponent analyzer;
+
+    // Covers the device buttons while open; opened from the right-click menu.
+    ProfilerComponent profiler;
+
     juce::ApplicationProperties appProperties;
 
-    int orgWidth{200}, orgHeight{230};
+    int orgWidth{200}, orgHeight{320}, analyzerHeight{90};
+
+   #if JUCE_MODULE_AVAILABLE_juce_opengl
+    // Optional GPU compositing. If no context can be created JUCE keeps painting in software.
+    juce::OpenGLContext openGLContext;
+   #endif
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QwikRefAudioProcessorEditor)
 };
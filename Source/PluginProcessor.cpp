@@ -9,31 +9,85 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+namespace
+{
+    // Program N is the Nth row of the device table. Reads the raw bytes, so a sysex in the buffer never
+    // gets copied into a MidiMessage here.
+    bool readProgramChange (const juce::MidiMessageMetadata& metadata, Device& device) noexcept
+    {
+        auto isProgramChange = metadata.numBytes == 2 && (metadata.data[0] & 0xf0) == 0xc0;
+
+        if (! isProgramChange || metadata.data[1] >= numDevices)
+            return false;
+
+        device = static_cast<Device>(metadata.data[1]);
+        return true;
+    }
+}
+
 //==============================================================================
 QwikRefAudioProcessor::QwikRefAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
-     : AudioProcessor (BusesProperties()
+     : AudioProcessor (makeBusesProperties())
+#endif
+{
+    for (auto& profile : deviceProfiles)
+        if (hasParameter (profile))
+            deviceParameters[static_cast<size_t>(profile.device)] = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter (profile.parameterID));
+
+    power = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("power"));
+    crossfade = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("crossfade"));
+    morph = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("morph"));
+    morphFrom = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("morphFrom"));
+    morphTo = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("morphTo"));
+    morphAmount = dynamic_cast<juce::AudioParameterFloat*>(apvts.getParameter("morphAmount"));
+    linearPhase = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("linearPhase"));
+    measured = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("measured"));
+    fanOut = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("fanOut"));
+    oversampling = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("oversampling"));
+    oversamplingQuality = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("oversamplingQuality"));
+    lfeBypass = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("lfeBypass"));
+    centrePhone = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("centrePhone"));
+    loudnessMatch = dynamic_cast<juce::AudioParameterChoice*>(apvts.getParameter("loudnessMatch"));
+    keepWarm = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("keepWarm"));
+
+    for (auto* parameter : getParameters())
+        if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter))
+            apvts.addParameterListener(withID->getParameterID(), this);
+
+    activeProfile.publish (getFirstEnabledDevice());
+    renderedProfile.publish (activeProfile.load().device);
+    startTimerHz (30);
+}
+
+#ifndef JucePlugin_PreferredChannelConfigurations
+juce::AudioProcessor::BusesProperties QwikRefAudioProcessor::makeBusesProperties()
+{
+    auto properties = BusesProperties()
                      #if ! JucePlugin_IsMidiEffect
                       #if ! JucePlugin_IsSynth
                        .withInput  ("Input",  juce::AudioChannelSet::stereo(), true)
                       #endif
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)
                      #endif
-                       )
-#endif
-{
-    car = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("car"));
-    laptop = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("laptop"));
-    phone = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("phone"));
-    tv = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("tv"));
-    airpods = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("airpods"));
-    btSpeaker = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("btSpeaker"));
-    power = dynamic_cast<juce::AudioParameterBool*>(apvts.getParameter("power"));
+                       ;
+
+    // One optional output per device, fed while fan out is on.
+    for (auto& profile : deviceProfiles)
+        if (hasParameter (profile))
+            properties.addBus (false, profile.name, juce::AudioChannelSet::stereo(), false);
 
+    return properties;
 }
+#endif
 
 QwikRefAudioProcessor::~QwikRefAudioProcessor()
 {
+    stopTimer();
+
+    for (auto* parameter : getParameters())
+        if (auto* withID = dynamic_cast<juce::AudioProcessorParameterWithID*>(parameter))
+            apvts.removeParameterListener(withID->getParameterID(), this);
 }
 
 //==============================================================================
@@ -71,7 +125,13 @@ bool QwikRefAudioProcessor::isMidiEffect() const
 
 double QwikRefAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    auto sampleRate = coefficientBank.getSampleRate();
+
+    if (sampleRate <= 0.0)
+        return 0.0;
+
+    // The same figure the audio thread waits out before going to sleep, for the path the active device renders on.
+    return getTailSamples (getRenderPath (activeProfile.load().device)) / sampleRate;
 }
 
 int QwikRefAudioProcessor::getNumPrograms()
@@ -98,23 +158,37 @@ void QwikRefAudioProcessor::changeProgramName (int index, const juce::String& ne
 {
 }
 
+void QwikRefAudioProcessor::updateTrackProperties (const TrackProperties& properties)
+{
+    // Lets the profiler say which track an overrun happened on, not just which instance.
+    profiler.setTrackName (properties.name.value_or (juce::String()));
+}
+
 //==============================================================================
 void QwikRefAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
-    juce::dsp::ProcessSpec spec;
-    spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
-    spec.sampleRate = sampleRate;
+    coefficientBank.prepare (sampleRate);
+    auto numChannels = getMainBusNumOutputChannels();
+
+    analyzer.setSampleRate (sampleRate);
+    profiler.prepare (sampleRate);
+    loudnessMatcher.prepare (getChannelLayoutOfBus (false, 0), sampleRate);
+    linearPhaseEngine.prepare (sampleRate, numChannels, samplesPerBlock);
+    measuredEngine.prepare (sampleRate, numChannels, samplesPerBlock);
 
-    for(int i = 0; i < 2; i++)
+    // The host picks the precision before preparing us, so only that set of engines needs memory.
+    if (isUsingDoublePrecision())
     {
-        lowCut[i].prepare(spec);
-        peak1[i].prepare(spec);
-        peak2[i].prepare(spec);
-        peak3[i].prepare(spec);
-        highCut[i].prepare(spec);
+        prepareEngines<double> (sampleRate, numChannels, samplesPerBlock);
+        convolutionScratch.setSize (numChannels, samplesPerBlock);
+    }
+    else
+    {
+        prepareEngines<float> (sampleRate, numChannels, samplesPerBlock);
+        convolutionScratch.setSize (0, 0);
     }
 
+    updateRenderPath();
 }
 
 void QwikRefAudioProcessor::releaseResources()
@@ -130,12 +204,8 @@ bool QwikRefAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout works, from mono up to immersive beds; every channel gets its own SIMD lane.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -144,240 +214,538 @@ bool QwikRefAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
         return false;
    #endif
 
+    // Device outputs are either switched off or match the main output
+    for (int bus = 1; bus < layouts.outputBuses.size(); ++bus)
+        if (! layouts.outputBuses[bus].isDisabled() && layouts.outputBuses[bus] != layouts.getMainOutputChannelSet())
+            return false;
+
     return true;
   #endif
 }
 #endif
 
 void QwikRefAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples (buffer, midiMessages, false);
+}
+
+void QwikRefAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples (buffer, midiMessages, false);
+}
+
+// Hosts that bypass us without going through the bypass parameter get the same fade and latency matching.
+void QwikRefAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples (buffer, midiMessages, true);
+}
+
+void QwikRefAudioProcessor::processBlockBypassed (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    processSamples (buffer, midiMessages, true);
+}
+
+template <typename SampleType>
+QwikRefAudioProcessor::PrecisionEngines<SampleType>& QwikRefAudioProcessor::getEngines() noexcept
+{
+    if constexpr (std::is_same_v<SampleType, float>)
+        return floatEngines;
+    else
+        return doubleEngines;
+}
+
+template <typename SampleType>
+void QwikRefAudioProcessor::prepareEngines (double sampleRate, int numChannels, int samplesPerBlock)
+{
+    auto& engines = getEngines<SampleType>();
+
+    engines.engine.prepare (sampleRate, numChannels, samplesPerBlock);
+    engines.fanOut.prepare (sampleRate, numChannels, samplesPerBlock);
+    engines.oversampled.prepare (sampleRate, numChannels, samplesPerBlock);
+
+    auto maximumLatency = juce::jmax (linearPhaseEngine.getLatencySamples(), engines.oversampled.getMaximumLatencySamples());
+    engines.channelGroups.prepare (getChannelLayoutOfBus (false, 0), sampleRate, samplesPerBlock, maximumLatency);
+    engines.bypass.prepare (sampleRate, numChannels, samplesPerBlock, maximumLatency);
+    flushPending = false;
+
+    silentSamples = 0;
+    lastOutputPeak = 0.0;
+    asleep = false;
+}
+
+template <typename SampleType>
+void QwikRefAudioProcessor::flushEngines() noexcept
+{
+    auto& engines = getEngines<SampleType>();
+
+    engines.engine.reset();
+    engines.fanOut.reset();
+    engines.oversampled.reset();
+    engines.channelGroups.reset();
+    linearPhaseEngine.reset();
+    measuredEngine.reset();
+}
+
+template <typename SampleType>
+void QwikRefAudioProcessor::processSamples (juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midiMessages, bool hostBypassed)
 {
     juce::ScopedNoDenormals noDenormals;
+    profiler.beginBlock (buffer.getNumSamples());
+    profiler.enterStage (BlockProfiler::Stage::bypass);
+
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    if (power->get()) { return; }
+    auto mainBuffer = getBusBuffer (buffer, false, 0);
+    auto block = juce::dsp::AudioBlock<SampleType> (mainBuffer);
+
+    auto& bypass = getEngines<SampleType>().bypass;
+    bypass.setBypassed (hostBypassed || power->get());
+
+    profiler.enterStage (BlockProfiler::Stage::analyzer);
+    analyzer.push (SpectrumAnalyzer::Tap::pre, block);
+
+    if (bypass.isFullyBypassed() && ! keepWarm->get())
+    {
+        // Faded out and not keeping warm: nothing renders, the dry signal only lines up with our latency.
+        profiler.enterStage (BlockProfiler::Stage::bypass);
+        followDeviceChanges (midiMessages);
+        bypass.process (block, getLatencySamples());
+        flushPending = true;
+    }
+    else
+    {
+        profiler.enterStage (BlockProfiler::Stage::render);
+
+        // Coming back from a flushed bypass, every filter starts from silence rather than stale history,
+        // and the fade back waits on dry until that silence has made it through our latency.
+        if (std::exchange (flushPending, false))
+        {
+            flushEngines<SampleType>();
+            bypass.holdDry (getLatencySamples());
+        }
+
+        // NaN or Inf from upstream would poison every filter it reached, so it goes no further than here.
+        profiler.enterStage (BlockProfiler::Stage::scan);
+        auto input = BlockHealth<SampleType>::scan (block);
+
+        if (! input.finite)
+            block.clear();
+
+        profiler.enterStage (BlockProfiler::Stage::bypass);
+        bypass.capture (block, getLatencySamples());
+
+        if (! updateSleep (input, block.getNumSamples()))
+        {
+            profiler.enterStage (BlockProfiler::Stage::loudness);
+            auto matchMode = static_cast<LoudnessMatch>(loudnessMatch->getIndex());
+            loudnessMatcher.measureInput (block, matchMode);
+            profiler.enterStage (BlockProfiler::Stage::render);
+            renderBlock (buffer, block, midiMessages);
+            profiler.enterStage (BlockProfiler::Stage::loudness);
+            loudnessMatcher.apply (block, matchMode, getStaticMatchGain());
+
+            // Bypassed channels skip the match gain as well as the render, so they only go back in now.
+            if (auto& channelGroups = getEngines<SampleType>().channelGroups; channelGroups.hasBypassedChannels())
+                channelGroups.restoreBypassed (block, getLatencySamples());
+
+            // A filter that blew up starts again from clean state instead of ringing out garbage for ever.
+            profiler.enterStage (BlockProfiler::Stage::scan);
+            auto output = BlockHealth<SampleType>::scan (block);
+            lastOutputPeak = static_cast<double>(output.peak);
+
+            if (! output.finite)
+            {
+                flushEngines<SampleType>();
+                block.clear();
+                lastOutputPeak = 0.0;
+            }
+        }
+        else
+        {
+            followDeviceChanges (midiMessages);
+        }
+
+        profiler.enterStage (BlockProfiler::Stage::bypass);
+        bypass.mix (block);
+    }
+
+    profiler.enterStage (BlockProfiler::Stage::analyzer);
+    analyzer.push (SpectrumAnalyzer::Tap::post, block);
+    profiler.endBlock();
+}
 
-    auto sampleRate = getSampleRate();
+template <typename SampleType>
+bool QwikRefAudioProcessor::updateSleep (const BlockHealth<SampleType>& input, size_t numSamples) noexcept
+{
+    constexpr auto silenceThreshold = static_cast<SampleType>(1.0e-7);   // -140 dBFS
 
-    juce::dsp::AudioBlock<float> blockRight;
+    if (input.isSilent (silenceThreshold))
+        silentSamples += static_cast<juce::int64>(numSamples);
+    else
+        silentSamples = 0;
 
-    auto block = juce::dsp::AudioBlock<float>(buffer);
-    auto blockLeft = block.getSingleChannelBlock(0);
-    blockRight = totalNumOutputChannels == 1 ? block.getSingleChannelBlock(0) : block.getSingleChannelBlock(1);
-    auto contextLeft = juce::dsp::ProcessContextReplacing<float>(blockLeft);
-    auto contextRight = juce::dsp::ProcessContextReplacing<float>(blockRight);
+    // Asleep once the tail of the path in use has had time to decay, or sooner if the output has already sunk
+    // into the denormal range after anything still in a latency delay has come out.
+    auto decayed = silentSamples > getTailSamples (lastPath)
+                || (silentSamples > getLatencySamples() && lastOutputPeak < std::numeric_limits<float>::min());
+
+    // Whatever is left in the filters on waking is at most a denormal, so they start again from zero.
+    if (asleep && ! decayed)
+        flushEngines<SampleType>();
+
+    asleep = decayed;
+    return asleep;
+}
+
+template <typename SampleType>
+void QwikRefAudioProcessor::renderBlock (juce::AudioBuffer<SampleType>& buffer, const juce::dsp::AudioBlock<SampleType>& block,
+                                         const juce::MidiBuffer& midiMessages)
+{
+    auto& engines = getEngines<SampleType>();
+    engines.engine.setCrossfadeTime (crossfade->get());
+    engines.fanOut.setMonitorFadeTime (crossfade->get());
+    engines.oversampled.setCrossfadeTime (crossfade->get());
 
-    if (car->get())
+    auto staticMatch = static_cast<LoudnessMatch>(loudnessMatch->getIndex()) == LoudnessMatch::staticCurve;
+    engines.engine.setLoudnessMatched (staticMatch);
+    engines.fanOut.setLoudnessMatched (staticMatch);
+    engines.oversampled.setLoudnessMatched (staticMatch);
+
+    // A parameter change since the last block takes over from whatever a program change picked.
+    auto snapshot = activeProfile.load();
+
+    if (snapshot.version != renderedVersion)
     {
-        float db5 = juce::Decibels::decibelsToGain(5.f);
-        float dbn5 = juce::Decibels::decibelsToGain(-5.f);
-
-        auto lowCutCoef = juce::dsp::IIR::Coefficients<float>::makeLowShelf(sampleRate, 100, .71, db5);
-        lowCut[0].coefficients = lowCutCoef;
-        lowCut[1].coefficients = lowCutCoef;
-        lowCut[0].process(contextLeft);
-        lowCut[1].process(contextRight);
-
-        auto peak1Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 625, .71, dbn5);
-        peak1[0].coefficients = peak1Coef;
-        peak1[1].coefficients = peak1Coef;
-        peak1[0].process(contextLeft);
-        peak1[1].process(contextRight);
-
-        auto peak2Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 1600, .71, dbn5);
-        peak2[0].coefficients = peak2Coef;
-        peak2[1].coefficients = peak2Coef;
-        peak2[0].process(contextLeft);
-        peak2[1].process(contextRight);
-
-        auto peak3Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 4000, .71, db5);
-        peak3[0].coefficients = peak3Coef;
-        peak3[1].coefficients = peak3Coef;
-        peak3[0].process(contextLeft);
-        peak3[1].process(contextRight);
-
-        auto highCutCoef = juce::dsp::IIR::Coefficients<float>::makeHighShelf(sampleRate, 10000, .71, juce::Decibels::decibelsToGain(10.f));
-        highCut[0].coefficients = highCutCoef;
-        highCut[1].coefficients = highCutCoef;
-        highCut[0].process(contextLeft);
-        highCut[1].process(contextRight);
+        renderedDevice = snapshot.device;
+        renderedVersion = snapshot.version;
     }
-    
-    else if (laptop->get())
+
+    engines.channelGroups.setOptions (lfeBypass->get(), centrePhone->get());
+
+    if (engines.channelGroups.hasSideChannels())
+        engines.channelGroups.capture (block);
+
+    // Program changes pick a device at their exact sample, so the block is rendered in pieces split at each one.
+    // That is sample accurate on the cascade paths only. The convolution paths keep playing the loaded kernel
+    // until the timer has woken the kernel thread, it has loaded the new one and the convolution has crossfaded
+    // to it, so there a program change lands up to a timer tick late, plus however long the kernel takes to load.
+    auto numSamples = block.getNumSamples();
+    size_t start = 0;
+
+    for (const auto metadata : midiMessages)
     {
-        float db10 = juce::Decibels::decibelsToGain(10.f);
-
-        auto lowCutCoef = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, 300);
-        lowCut[0].coefficients = lowCutCoef;
-        lowCut[1].coefficients = lowCutCoef;
-        lowCut[0].process(contextLeft);
-        lowCut[1].process(contextRight);
-
-        auto peak1Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 700, 1, db10);
-        peak1[0].coefficients = peak1Coef;
-        peak1[1].coefficients = peak1Coef;
-        peak1[0].process(contextLeft);
-        peak1[1].process(contextRight);
-
-        auto peak2Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 2000, .5, juce::Decibels::decibelsToGain(-5.f));
-        peak2[0].coefficients = peak2Coef;
-        peak2[1].coefficients = peak2Coef;
-        peak2[0].process(contextLeft);
-        peak2[1].process(contextRight);
-
-        auto peak3Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 6000, .3, juce::Decibels::decibelsToGain(5.f));
-        peak3[0].coefficients = peak3Coef;
-        peak3[1].coefficients = peak3Coef;
-        peak3[0].process(contextLeft);
-        peak3[1].process(contextRight);
-
-        auto highCutCoef = juce::dsp::IIR::Coefficients<float>::makeHighShelf   (sampleRate, 10000, .71, juce::Decibels::decibelsToGain(-5.f));
-        highCut[0].coefficients = highCutCoef;
-        highCut[1].coefficients = highCutCoef;
-        highCut[0].process(contextLeft);
-        highCut[1].process(contextRight);
+        auto device = renderedDevice;
+
+        if (! readProgramChange (metadata, device))
+            continue;
+
+        auto position = static_cast<size_t>(juce::jlimit (0, static_cast<int>(numSamples), metadata.samplePosition));
+
+        if (position > start)
+        {
+            renderRange (buffer, block.getSubBlock (start, position - start), start, renderedDevice);
+            start = position;
+        }
+
+        renderedDevice = device;
     }
 
+    if (start < numSamples)
+        renderRange (buffer, block.getSubBlock (start, numSamples - start), start, renderedDevice);
 
-    else if (phone->get())
+    publishRenderedDevice();
+
+    if (engines.channelGroups.hasSideChannels())
+        engines.channelGroups.render (block, getLatencySamples());
+}
+
+template <typename SampleType>
+void QwikRefAudioProcessor::renderRange (juce::AudioBuffer<SampleType>& buffer, const juce::dsp::AudioBlock<SampleType>& block,
+                                         size_t startSample, Device device)
+{
+    auto& engines = getEngines<SampleType>();
+    auto path = getRenderPath (device);
+
+    // Each path has its own latency and history, so the one we switch to starts from clean state.
+    if (path != lastPath)
     {
-        auto lowCutCoef = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, 800);
-        lowCut[0].coefficients = lowCutCoef;
-        lowCut[1].coefficients = lowCutCoef;
-        lowCut[0].process(contextLeft);
-        lowCut[1].process(contextRight);
-
-        auto peak1Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 1000, .71, juce::Decibels::decibelsToGain(5.f));
-        peak1[0].coefficients = peak1Coef;
-        peak1[1].coefficients = peak1Coef;
-        peak1[0].process(contextLeft);
-        peak1[1].process(contextRight);
-
-        auto peak2Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 3000, .71, juce::Decibels::decibelsToGain(8.f));
-        peak2[0].coefficients = peak2Coef;
-        peak2[1].coefficients = peak2Coef;
-        peak2[0].process(contextLeft);
-        peak2[1].process(contextRight);
-
-        auto peak3Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 7500, .71, juce::Decibels::decibelsToGain(10.f));
-        peak3[0].coefficients = peak3Coef;
-        peak3[1].coefficients = peak3Coef;
-        peak3[0].process(contextLeft);
-        peak3[1].process(contextRight);
-
-        auto highCutCoef = juce::dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, 12000);
-        highCut[0].coefficients = highCutCoef;
-        highCut[1].coefficients = highCutCoef;
-        highCut[0].process(contextLeft);
-        highCut[1].process(contextRight);
-        
+        lastPath = path;
+
+        switch (path)
+        {
+            case RenderPath::biquad:      engines.engine.reset(); break;
+            case RenderPath::linearPhase: linearPhaseEngine.reset(); break;
+            case RenderPath::measured:    measuredEngine.reset(); break;
+            case RenderPath::fanOut:      engines.fanOut.reset(); break;
+            case RenderPath::oversampled: engines.oversampled.reset(); break;
+        }
+
+        engines.channelGroups.reset();
     }
 
-    else if (tv->get())
+    if (path == RenderPath::linearPhase)
+        processConvolution (linearPhaseEngine, block, device);
+    else if (path == RenderPath::measured)
+        processConvolution (measuredEngine, block, device);
+    else if (path == RenderPath::fanOut)
+        processFanOut (buffer, block, startSample, device);
+    else if (path == RenderPath::oversampled)
+        processOversampled (block, device);
+    else if (morph->get())
+        engines.engine.processMorph (block, static_cast<Device>(morphFrom->getIndex()), static_cast<Device>(morphTo->getIndex()),
+                                     static_cast<SampleType>(morphAmount->get()));
+    else
+        engines.engine.process (block, device);
+}
+
+template <typename SampleType>
+void QwikRefAudioProcessor::processConvolution (DeviceConvolver& convolver, const juce::dsp::AudioBlock<SampleType>& block, Device device)
+{
+    if constexpr (std::is_same_v<SampleType, float>)
     {
-        auto lowCutCoef = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, 100);
-        lowCut[0].coefficients = lowCutCoef;
-        lowCut[1].coefficients = lowCutCoef;
-        lowCut[0].process(contextLeft);
-        lowCut[1].process(contextRight);
-
-        auto peak1Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 300, .71, juce::Decibels::decibelsToGain(10.f));
-        peak1[0].coefficients = peak1Coef;
-        peak1[1].coefficients = peak1Coef;
-        peak1[0].process(contextLeft);
-        peak1[1].process(contextRight);
-
-        auto peak2Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 2250, .71, juce::Decibels::decibelsToGain(-2.5));
-        peak2[0].coefficients = peak2Coef;
-        peak2[1].coefficients = peak2Coef;;
-        peak2[0].process(contextLeft);
-        peak2[1].process(contextRight);
-
-        auto peak3Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 10000, .71, juce::Decibels::decibelsToGain(-10.f));
-        peak3[0].coefficients = peak3Coef;
-        peak3[1].coefficients = peak3Coef;
-        peak3[0].process(contextLeft);
-        peak3[1].process(contextRight);
-
-        auto highCutCoef = juce::dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, 15000);
-        highCut[0].coefficients = highCutCoef;
-        highCut[1].coefficients = highCutCoef;
-        highCut[0].process(contextLeft);
-        highCut[1].process(contextRight);
+        convolver.process (block, device);
     }
+    else
+    {
+        // juce::dsp::Convolution is float only, so double blocks make a round trip through a float scratch buffer.
+        auto scratchLength = static_cast<size_t>(convolutionScratch.getNumSamples());
+        auto numChannels = juce::jmin (block.getNumChannels(), static_cast<size_t>(convolutionScratch.getNumChannels()));
 
-    else if (airpods->get())
+        for (size_t start = 0; start < block.getNumSamples(); start += scratchLength)
+        {
+            auto chunk = block.getSubBlock (start, juce::jmin (block.getNumSamples() - start, scratchLength));
+            auto scratch = juce::dsp::AudioBlock<float> (convolutionScratch).getSubsetChannelBlock (0, numChannels)
+                                                                             .getSubBlock (0, chunk.getNumSamples());
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+                std::copy_n (chunk.getChannelPointer (channel), chunk.getNumSamples(), scratch.getChannelPointer (channel));
+
+            convolver.process (scratch, device);
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+                std::copy_n (scratch.getChannelPointer (channel), chunk.getNumSamples(), chunk.getChannelPointer (channel));
+        }
+    }
+}
+
+template <typename SampleType>
+void QwikRefAudioProcessor::processFanOut (juce::AudioBuffer<SampleType>& buffer, const juce::dsp::AudioBlock<SampleType>& block,
+                                           size_t startSample, Device monitor)
+{
+    auto& fanOutEngine = getEngines<SampleType>().fanOut;
+    fanOutEngine.process (block, monitor);
+
+    // Device buses follow the table order, right after the main output.
+    auto bus = 1;
+
+    for (auto& profile : deviceProfiles)
     {
-        float db5 = juce::Decibels::decibelsToGain(5.f);
-
-        auto lowCutCoef = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, 100);
-        lowCut[0].coefficients = lowCutCoef;
-        lowCut[1].coefficients = lowCutCoef;
-        lowCut[0].process(contextLeft);
-        lowCut[1].process(contextRight);
-
-        auto peak1Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 200, .4, juce::Decibels::decibelsToGain(2.5));
-        peak1[0].coefficients = peak1Coef;
-        peak1[1].coefficients = peak1Coef;
-        peak1[0].process(contextLeft);
-        peak1[1].process(contextRight);
-
-        auto peak2Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 2000, .71, db5);
-        peak2[0].coefficients = peak2Coef;
-        peak2[1].coefficients = peak2Coef;
-        peak2[0].process(contextLeft);
-        peak2[1].process(contextRight);
-
-        auto peak3Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 10000, 2, db5);
-        peak3[0].coefficients = peak3Coef;
-        peak3[1].coefficients = peak3Coef;
-        peak3[0].process(contextLeft);
-        peak3[1].process(contextRight);
-
-        auto highCutCoef = juce::dsp::IIR::Coefficients<float>::makeLowPass(sampleRate, 15000);
-        highCut[0].coefficients = highCutCoef;
-        highCut[1].coefficients = highCutCoef;
-        highCut[0].process(contextLeft);
-        highCut[1].process(contextRight);
+        if (! hasParameter (profile) || bus >= getBusCount (false))
+            continue;
+
+        auto busBuffer = getBusBuffer (buffer, false, bus++);
+
+        if (busBuffer.getNumChannels() > 0)
+            juce::dsp::AudioBlock<SampleType> (busBuffer).getSubBlock (startSample, block.getNumSamples())
+                                                         .copyFrom (fanOutEngine.getDeviceOutput (profile.device, block.getNumSamples()));
     }
+}
+
+template <typename SampleType>
+void QwikRefAudioProcessor::processOversampled (const juce::dsp::AudioBlock<SampleType>& block, Device device)
+{
+    auto& oversampledEngine = getEngines<SampleType>().oversampled;
+    auto factor = oversampling->getIndex();
+    auto quality = static_cast<OversamplingQuality>(oversamplingQuality->getIndex());
 
+    if (morph->get())
+        oversampledEngine.processMorph (block, factor, quality, static_cast<Device>(morphFrom->getIndex()),
+                                        static_cast<Device>(morphTo->getIndex()), static_cast<SampleType>(morphAmount->get()));
     else
+        oversampledEngine.process (block, factor, quality, device);
+}
+
+// While nothing renders (bypassed or asleep), device changes still land, so the device we come back to is the right one.
+void QwikRefAudioProcessor::followDeviceChanges (const juce::MidiBuffer& midiMessages) noexcept
+{
+    auto snapshot = activeProfile.load();
+
+    if (snapshot.version != renderedVersion)
     {
-        float db = juce::Decibels::decibelsToGain(-2.5);
-
-        auto lowCutCoef = juce::dsp::IIR::Coefficients<float>::makeHighPass(sampleRate, 60);
-        lowCut[0].coefficients = lowCutCoef;
-        lowCut[1].coefficients = lowCutCoef;
-        lowCut[0].process(contextLeft);
-        lowCut[1].process(contextRight);
-
-        auto peak1Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 100, 2, juce::Decibels::decibelsToGain(-15.f));
-        peak1[0].coefficients = peak1Coef;
-        peak1[1].coefficients = peak1Coef;
-        peak1[0].process(contextLeft);
-        peak1[1].process(contextRight);
-
-        auto peak2Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 300, .4, juce::Decibels::decibelsToGain(2.5));
-        peak2[0].coefficients = peak2Coef;
-        peak2[1].coefficients = peak2Coef;
-        peak2[0].process(contextLeft);
-        peak2[1].process(contextRight);
-
-        auto peak3Coef = juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate, 2500, .3, db);
-        peak3[0].coefficients = peak3Coef;
-        peak3[1].coefficients = peak3Coef;
-        peak3[0].process(contextLeft);
-        peak3[1].process(contextRight);
-
-        auto highCutCoef = juce::dsp::IIR::Coefficients<float>::makeHighShelf(sampleRate, 10000, .71, db);
-        highCut[0].coefficients = highCutCoef;
-        highCut[1].coefficients = highCutCoef;
-        highCut[0].process(contextLeft);
-        highCut[1].process(contextRight);
+        renderedDevice = snapshot.device;
+        renderedVersion = snapshot.version;
     }
+
+    for (const auto metadata : midiMessages)
+        readProgramChange (metadata, renderedDevice);
+
+    publishRenderedDevice();
+}
+
+void QwikRefAudioProcessor::publishRenderedDevice() noexcept
+{
+    if (renderedProfile.load().device != renderedDevice)
+        renderedProfile.publish (renderedDevice);
+}
+
+void QwikRefAudioProcessor::parameterChanged (const juce::String& parameterID, float newValue)
+{
+    for (auto& profile : deviceProfiles)
+        if (hasParameter (profile) && parameterID == profile.parameterID)
+            activeProfile.publish (resolveActiveDevice (profile.device, newValue >= 0.5f));
+
+    // Rather than a list of the parameters that pick a path, whatever the settings now call for is compared with
+    // what the host was last told. The convolution switches also build or stop their engine, so they always count.
+    auto switchesEngine = parameterID == "linearPhase" || parameterID == "measured";
+    auto path = getRenderPath (activeProfile.load().device);
+
+    if (! switchesEngine && path == reportedPath.load() && getPathLatencySamples (path) == getLatencySamples())
+        return;
+
+    // Telling the host about new latency belongs on the message thread. Automation arrives on the audio
+    // thread, which only leaves a flag behind for the timer rather than calling into the host from there.
+    if (juce::MessageManager::existsAndIsCurrentThread())
+        updateRenderPath();
+    else
+        renderPathPending.store (true);
+}
+
+void QwikRefAudioProcessor::timerCallback()
+{
+    if (renderPathPending.exchange (false))
+        updateRenderPath();
+
+    // The audio thread only records which device it wants from a convolution engine; waking the kernel thread takes a lock.
+    linearPhaseEngine.wakeForRequestedDevice();
+    measuredEngine.wakeForRequestedDevice();
+}
+
+// Never the audio thread: building a convolution engine allocates and starts a thread. Each convolution
+// engine only exists while its switch is on; the audio thread keeps to the biquads until it is ready.
+void QwikRefAudioProcessor::updateRenderPath()
+{
+    linearPhaseEngine.setEnabled (linearPhase->get());
+    measuredEngine.setEnabled (measured->get());
+    updateLatency();
+}
+
+void QwikRefAudioProcessor::updateLatency()
+{
+    auto path = getRenderPath (activeProfile.load().device);
+
+    reportedPath.store (path);
+    setLatencySamples (getPathLatencySamples (path));
+}
+
+int QwikRefAudioProcessor::getPathLatencySamples (RenderPath path) const noexcept
+{
+    switch (path)
+    {
+        case RenderPath::linearPhase: return linearPhaseEngine.getLatencySamples();
+        case RenderPath::oversampled:
+        {
+            auto quality = static_cast<OversamplingQuality>(oversamplingQuality->getIndex());
+            return isUsingDoublePrecision() ? doubleEngines.oversampled.getLatencySamples (oversampling->getIndex(), quality)
+                                            : floatEngines.oversampled.getLatencySamples (oversampling->getIndex(), quality);
+        }
+        case RenderPath::biquad:
+        case RenderPath::measured:
+        case RenderPath::fanOut:
+        default:
+            return 0;
+    }
+}
+
+QwikRefAudioProcessor::RenderPath QwikRefAudioProcessor::getRenderPath (Device device) const noexcept
+{
+    if (linearPhase->get() && linearPhaseEngine.isReady())
+        return RenderPath::linearPhase;
+
+    if (measured->get() && measuredEngine.isReady() && measuredEngine.hasImpulseResponse (device))
+        return RenderPath::measured;
+
+    if (fanOut->get())
+        return RenderPath::fanOut;
+
+    if (oversampling->getIndex() > 0)
+        return RenderPath::oversampled;
+
+    return RenderPath::biquad;
+}
+
+// How long the output of 'path' keeps going once the input stops, latency included. The cascades' figure is
+// the slowest profile's, since the device can change at any sample without the host hearing about it.
+int QwikRefAudioProcessor::getTailSamples (RenderPath path) const noexcept
+{
+    switch (path)
+    {
+        case RenderPath::linearPhase: return linearPhaseEngine.getTailSamples();
+        case RenderPath::measured:    return measuredEngine.getTailSamples();
+        case RenderPath::oversampled:
+        {
+            auto quality = static_cast<OversamplingQuality>(oversamplingQuality->getIndex());
+            return isUsingDoublePrecision() ? doubleEngines.oversampled.getTailSamples (oversampling->getIndex(), quality)
+                                            : floatEngines.oversampled.getTailSamples (oversampling->getIndex(), quality);
+        }
+        case RenderPath::biquad:
+        case RenderPath::fanOut:
+        default:
+            return coefficientBank.getMaximumTailSamples();
+    }
+}
+
+// Automation can turn on several devices at once. The last one switched on wins, and switching
+// the winner off falls back to whichever device is still on, in table order.
+Device QwikRefAudioProcessor::resolveActiveDevice (Device changed, bool isOn) const noexcept
+{
+    if (isOn)
+        return changed;
+
+    auto current = activeProfile.load().device;
+    return current != changed ? current : getFirstEnabledDevice();
+}
+
+Device QwikRefAudioProcessor::getFirstEnabledDevice() const noexcept
+{
+    for (size_t i = 0; i < deviceParameters.size(); ++i)
+        if (deviceParameters[i] != nullptr && deviceParameters[i]->get())
+            return static_cast<Device>(i);
+
+    return Device::flat;
+}
+
+// The cascades carry the static compensation themselves; only the linear-phase kernels, designed
+// from the plain curves, need it applied afterwards. Measured IRs are already normalised on load.
+ResponseCurve::Settings QwikRefAudioProcessor::getResponseSettings() const noexcept
+{
+    ResponseCurve::Settings settings;
+    settings.device = renderedProfile.load().device;
+
+    // Static matching is folded into the cascades or applied as the same gain afterwards on every path but the
+    // measured one, whose IRs are normalised instead. Morphing and oversampling only exist on the cascade paths.
+    auto path = getRenderPath (settings.device);
+    auto cascades = path == RenderPath::biquad || path == RenderPath::oversampled;
+
+    settings.matched = static_cast<LoudnessMatch>(loudnessMatch->getIndex()) == LoudnessMatch::staticCurve && path != RenderPath::measured;
+    settings.morphing = cascades && morph->get();
+    settings.morphFrom = static_cast<Device>(morphFrom->getIndex());
+    settings.morphTo = static_cast<Device>(morphTo->getIndex());
+    settings.morphAmount = morphAmount->get();
+    settings.oversamplingFactor = path == RenderPath::oversampled ? 1 << oversampling->getIndex() : 1;
+
+    return settings;
+}
+
+float QwikRefAudioProcessor::getStaticMatchGain() const noexcept
+{
+    if (getRenderPath (renderedDevice) != RenderPath::linearPhase)
+        return 0.f;
+
+    return static_cast<float>(juce::Decibels::gainToDecibels (coefficientBank.getCompensationGain (renderedDevice)));
 }
 
 //==============================================================================
@@ -403,6 +771,10 @@ void QwikRefAudioProcessor::setStateInformation (const void* data, int sizeInByt
     auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
     if (tree.isValid()) {
         apvts.replaceState(tree);
+
+        // Restored switches arrive in no particular order, so settle on the table order instead.
+        activeProfile.publish (getFirstEnabledDevice());
+        renderedProfile.publish (activeProfile.load().device);
     }
 }
 
@@ -412,13 +784,32 @@ juce::AudioProcessorValueTreeState::ParameterLayout QwikRefAudioProcessor::creat
 
     AudioProcessorValueTreeState::ParameterLayout layout;
 
-    layout.add(std::make_unique<AudioParameterBool>("car", "Car", true));
-    layout.add(std::make_unique<AudioParameterBool>("laptop", "Laptop", false));
-    layout.add(std::make_unique<AudioParameterBool>("phone", "Phone", false));
-    layout.add(std::make_unique<AudioParameterBool>("tv", "TV", false));
-    layout.add(std::make_unique<AudioParameterBool>("airpods", "Airpods", false));
-    layout.add(std::make_unique<AudioParameterBool>("btSpeaker", "BT Speaker", false));
+    for (auto& profile : deviceProfiles)
+        if (hasParameter (profile))
+            layout.add(std::make_unique<AudioParameterBool>(profile.parameterID, profile.name, profile.defaultOn));
+
     layout.add(std::make_unique<AudioParameterBool>("power", "Power", true));
+    layout.add(std::make_unique<AudioParameterFloat>("crossfade", "Crossfade", NormalisableRange<float>(0.f, 250.f, 1.f), 20.f,
+                                                     AudioParameterFloatAttributes().withLabel("ms")));
+
+    StringArray deviceNames;
+    for (auto& profile : deviceProfiles)
+        deviceNames.add(profile.name);
+
+    layout.add(std::make_unique<AudioParameterBool>("morph", "Morph", false));
+    layout.add(std::make_unique<AudioParameterChoice>("morphFrom", "Morph From", deviceNames, static_cast<int>(Device::car)));
+    layout.add(std::make_unique<AudioParameterChoice>("morphTo", "Morph To", deviceNames, static_cast<int>(Device::phone)));
+    layout.add(std::make_unique<AudioParameterFloat>("morphAmount", "Morph Amount", 0.f, 1.f, 0.f));
+    layout.add(std::make_unique<AudioParameterBool>("linearPhase", "Linear Phase", false));
+    layout.add(std::make_unique<AudioParameterBool>("measured", "Measured IR", false));
+    layout.add(std::make_unique<AudioParameterBool>("fanOut", "Fan Out", false));
+    layout.add(std::make_unique<AudioParameterChoice>("oversampling", "Oversampling", StringArray{ "Off", "2x", "4x" }, 0));
+    layout.add(std::make_unique<AudioParameterChoice>("oversamplingQuality", "Oversampling Quality",
+                                                      StringArray{ "Low CPU", "Balanced", "Linear Phase" }, 1));
+    layout.add(std::make_unique<AudioParameterBool>("lfeBypass", "LFE Bypass", true));
+    layout.add(std::make_unique<AudioParameterBool>("centrePhone", "Centre As Phone", false));
+    layout.add(std::make_unique<AudioParameterChoice>("loudnessMatch", "Loudness Match", StringArray{ "Off", "Static", "Dynamic" }, 0));
+    layout.add(std::make_unique<AudioParameterBool>("keepWarm", "Keep Warm When Bypassed", false));
 
     return layout;
 }
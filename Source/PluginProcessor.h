@@ -10,11 +10,26 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <juce_dsp/juce_dsp.h>
+#include "ActiveProfile.h"
+#include "BlockHealth.h"
+#include "BlockProfiler.h"
+#include "ChannelGroups.h"
+#include "DeviceEngine.h"
+#include "FanOutEngine.h"
+#include "LinearPhaseEngine.h"
+#include "LoudnessMatcher.h"
+#include "MeasuredResponseEngine.h"
+#include "OversampledEngine.h"
+#include "ResponseCurve.h"
+#include "SmoothBypass.h"
+#include "SpectrumAnalyzer.h"
 
 //==============================================================================
 /**
 */
-class QwikRefAudioProcessor  : public juce::AudioProcessor
+class QwikRefAudioProcessor  : public juce::AudioProcessor,
+                               private juce::AudioProcessorValueTreeState::Listener,
+                               private juce::Timer
 {
 public:
     //==============================================================================
@@ -30,6 +45,11 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
+    juce::AudioProcessorParameter* getBypassParameter() const override { return power; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -49,6 +69,7 @@ public:
     void setCurrentProgram (int index) override;
     const juce::String getProgramName (int index) override;
     void changeProgramName (int index, const juce::String& newName) override;
+    void updateTrackProperties (const TrackProperties& properties) override;
 
     //==============================================================================
     void getStateInformation (juce::MemoryBlock& destData) override;
@@ -56,17 +77,108 @@ public:
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState apvts{ *this, nullptr, "parameters", createParameterLayout() };
 
-private:
+    SpectrumAnalyzer& getAnalyzer() noexcept { return analyzer; }
+    // Message thread: the coefficients behind the device the audio thread last rendered, for the editor's curve.
+    ResponseCurve::Settings getResponseSettings() const noexcept;
+    LoudnessMatcher& getLoudnessMatcher() noexcept { return loudnessMatcher; }
+    BlockProfiler& getProfiler() noexcept { return profiler; }
 
-    std::array<juce::dsp::IIR::Filter<float>,2> lowCut, peak1, peak2, peak3, highCut;
+private:
+   #ifndef JucePlugin_PreferredChannelConfigurations
+    static BusesProperties makeBusesProperties();
+   #endif
 
-    juce::AudioParameterBool* car{ nullptr };
-    juce::AudioParameterBool* laptop{ nullptr };
-    juce::AudioParameterBool* phone{ nullptr };
-    juce::AudioParameterBool* tv{ nullptr };
-    juce::AudioParameterBool* airpods{ nullptr };
-    juce::AudioParameterBool* btSpeaker{ nullptr };
+    // Everything that runs at the host's sample precision. Only the set in use gets prepared.
+    template <typename SampleType>
+    struct PrecisionEngines
+    {
+        explicit PrecisionEngines (const CoefficientBank& bank) : engine (bank), fanOut (bank), channelGroups (bank) {}
+
+        DeviceEngine<SampleType> engine;
+        FanOutEngine<SampleType> fanOut;
+        OversampledEngine<SampleType> oversampled;
+        ChannelGroups<SampleType> channelGroups;
+        SmoothBypass<SampleType> bypass;
+    };
+
+    template <typename SampleType> PrecisionEngines<SampleType>& getEngines() noexcept;
+    template <typename SampleType> void prepareEngines (double sampleRate, int numChannels, int samplesPerBlock);
+    template <typename SampleType> void flushEngines() noexcept;
+    template <typename SampleType> bool updateSleep (const BlockHealth<SampleType>& input, size_t numSamples) noexcept;
+    template <typename SampleType>
+    void processSamples (juce::AudioBuffer<SampleType>& buffer, const juce::MidiBuffer& midiMessages, bool hostBypassed);
+
+    template <typename SampleType>
+    void renderBlock (juce::AudioBuffer<SampleType>& buffer, const juce::dsp::AudioBlock<SampleType>& block, const juce::MidiBuffer& midiMessages);
+
+    template <typename SampleType>
+    void renderRange (juce::AudioBuffer<SampleType>& buffer, const juce::dsp::AudioBlock<SampleType>& block, size_t startSample, Device device);
+
+    template <typename SampleType>
+    void processConvolution (DeviceConvolver& convolver, const juce::dsp::AudioBlock<SampleType>& block, Device device);
+    template <typename SampleType>
+    void processFanOut (juce::AudioBuffer<SampleType>& buffer, const juce::dsp::AudioBlock<SampleType>& block, size_t startSample, Device monitor);
+    template <typename SampleType>
+    void processOversampled (const juce::dsp::AudioBlock<SampleType>& block, Device device);
+
+    void followDeviceChanges (const juce::MidiBuffer& midiMessages) noexcept;
+    void publishRenderedDevice() noexcept;
+    void parameterChanged (const juce::String& parameterID, float newValue) override;
+    void timerCallback() override;
+    void updateRenderPath();
+    void updateLatency();
+    Device resolveActiveDevice (Device changed, bool isOn) const noexcept;
+    Device getFirstEnabledDevice() const noexcept;
+    float getStaticMatchGain() const noexcept;
+
+    CoefficientBank coefficientBank;
+    PrecisionEngines<float> floatEngines{ coefficientBank };
+    PrecisionEngines<double> doubleEngines{ coefficientBank };
+    LinearPhaseEngine linearPhaseEngine;
+    MeasuredResponseEngine measuredEngine;
+    juce::AudioBuffer<float> convolutionScratch;
+    SpectrumAnalyzer analyzer;
+    LoudnessMatcher loudnessMatcher;
+    BlockProfiler profiler;
+
+    enum class RenderPath { biquad, linearPhase, measured, fanOut, oversampled };
+    RenderPath lastPath{ RenderPath::biquad };
+    Device renderedDevice{ Device::flat };
+    std::uint32_t renderedVersion{ ~0u };
+    bool flushPending{ false };
+
+    // Sleep: once the input has been silent for longer than the path in use rings, nothing renders.
+    juce::int64 silentSamples{ 0 };
+    double lastOutputPeak{ 0.0 };
+    bool asleep{ false };
+
+    RenderPath getRenderPath (Device device) const noexcept;
+    int getPathLatencySamples (RenderPath path) const noexcept;
+    int getTailSamples (RenderPath path) const noexcept;
+
+    ActiveProfile activeProfile;
+    ActiveProfile renderedProfile;   // what the audio thread last rendered, for the editor's curve
+
+    // Set when automation changes the render path off the message thread; the timer applies it from there.
+    std::atomic<bool> renderPathPending{ false };
+    std::atomic<RenderPath> reportedPath{ RenderPath::biquad };   // the path whose latency the host was last told
+
+    std::array<juce::AudioParameterBool*, numDevices> deviceParameters{};
     juce::AudioParameterBool* power{ nullptr };
+    juce::AudioParameterFloat* crossfade{ nullptr };
+    juce::AudioParameterBool* morph{ nullptr };
+    juce::AudioParameterChoice* morphFrom{ nullptr };
+    juce::AudioParameterChoice* morphTo{ nullptr };
+    juce::AudioParameterFloat* morphAmount{ nullptr };
+    juce::AudioParameterBool* linearPhase{ nullptr };
+    juce::AudioParameterBool* measured{ nullptr };
+    juce::AudioParameterBool* fanOut{ nullptr };
+    juce::AudioParameterChoice* oversampling{ nullptr };
+    juce::AudioParameterChoice* oversamplingQuality{ nullptr };
+    juce::AudioParameterBool* lfeBypass{ nullptr };
+    juce::AudioParameterBool* centrePhone{ nullptr };
+    juce::AudioParameterChoice* loudnessMatch{ nullptr };
+    juce::AudioParameterBool* keepWarm{ nullptr };
 
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (QwikRefAudioProcessor)
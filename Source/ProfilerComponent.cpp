@@ -0,0 +1,181 @@
+/*
+  ==============================================================================
+
+    ProfilerComponent.cpp
+
+  ==============================================================================
+*/
+
+#include "ProfilerComponent.h"
+
+namespace
+{
+    constexpr int headerHeight = 16;
+    constexpr int rowHeight = 12;
+    constexpr int labelWidth = 56;
+
+    juce::String formatMicros (double micros)   { return juce::String (micros, micros < 100.0 ? 1 : 0); }
+    juce::String formatPercent (double budget)  { return juce::String (budget * 100.0, 1); }
+}
+
+ProfilerComponent::ProfilerComponent (BlockProfiler& profilerToShow)
+    : profiler (profilerToShow)
+{
+    exportButton.onClick = [this] { exportTrace(); };
+    collapseButton.onClick = [this]
+    {
+        if (onCollapse != nullptr)
+            onCollapse();
+    };
+
+    addAndMakeVisible (exportButton);
+    addAndMakeVisible (collapseButton);
+}
+
+ProfilerComponent::~ProfilerComponent()
+{
+    stopTimer();
+    profiler.setActive (false);
+}
+
+void ProfilerComponent::paint (juce::Graphics& g)
+{
+    auto bounds = getLocalBounds();
+
+    g.fillAll (juce::Colours::black.withAlpha (0.92f));
+    g.setColour (juce::Colours::white.withAlpha (0.35f));
+    g.drawRect (bounds);
+
+    auto header = bounds.removeFromTop (headerHeight).reduced (4, 0);
+    g.setColour (juce::Colours::white);
+    g.setFont (11.f);
+    g.drawText (exportStatus.isNotEmpty() ? exportStatus : juce::String ("Performance"), header, juce::Justification::centredLeft);
+
+    bounds.reduce (4, 2);
+    g.setFont (10.f);
+
+    // A label and up to four right-aligned columns per row.
+    auto drawRow = [&] (const juce::String& label, std::initializer_list<juce::String> columns, juce::Colour colour)
+    {
+        auto row = bounds.removeFromTop (rowHeight);
+        g.setColour (colour);
+        g.drawText (label, row.removeFromLeft (labelWidth), juce::Justification::centredLeft);
+
+        auto columnWidth = row.getWidth() / 4;
+
+        for (auto& column : columns)
+            g.drawText (column, row.removeFromLeft (columnWidth), juce::Justification::centredRight);
+    };
+
+    auto white = juce::Colours::white;
+    auto dim = juce::Colours::white.withAlpha (0.5f);
+    auto alert = juce::Colour (230u, 90u, 64u);
+
+    drawRow (stats.instance.isNotEmpty() ? stats.instance : juce::String ("Waiting for audio"), {}, white);
+    bounds.removeFromTop (2);
+
+    drawRow ({}, { "min", "mean", "p99", "max" }, dim);
+    drawRow ("us", { formatMicros (stats.minMicros), formatMicros (stats.meanMicros),
+                     formatMicros (stats.p99Micros), formatMicros (stats.maxMicros) }, white);
+    drawRow ("budget %", { {}, formatPercent (stats.meanBudget), formatPercent (stats.p99Budget), formatPercent (stats.maxBudget) },
+             stats.maxBudget > 1.0 ? alert : white);
+    bounds.removeFromTop (4);
+
+    // The worst column shows where the time went in the block that came closest to (or past) its deadline.
+    drawRow ("stage us", { {}, "mean", "max", "worst" }, dim);
+
+    for (int stage = 0; stage < BlockProfiler::numStages; ++stage)
+    {
+        auto index = static_cast<size_t>(stage);
+        drawRow (BlockProfiler::getName (static_cast<BlockProfiler::Stage>(stage)),
+                 { {}, formatMicros (stats.stageMeanMicros[index]), formatMicros (stats.stageMaxMicros[index]),
+                   formatMicros (stats.worstStageMicros[index]) }, white);
+    }
+
+    bounds.removeFromTop (4);
+
+    drawRow ("overruns", { juce::String (stats.overruns), "dropped", juce::String (stats.dropped) },
+             stats.overruns > 0 ? alert : white);
+
+    if (stats.worstBudget > 0.0)
+        drawRow ("worst", { formatPercent (stats.worstBudget) + "%", {}, {}, stats.worstTime.toString (false, true, true, true) },
+                 stats.worstBudget > 1.0 ? alert : white);
+
+    drawRow ("over", { juce::String (stats.numBlocks), "blocks" }, dim);
+}
+
+void ProfilerComponent::resized()
+{
+    auto header = getLocalBounds().removeFromTop (headerHeight).reduced (2);
+
+    collapseButton.setBounds (header.removeFromRight (header.getHeight()));
+    header.removeFromRight (2);
+    exportButton.setBounds (header.removeFromRight (40));
+}
+
+void ProfilerComponent::visibilityChanged()
+{
+    // Nothing to poll for while collapsed.
+    if (isVisible())
+        startTimerHz (4);
+    else
+        stopTimer();
+
+    updateActivity();
+}
+
+void ProfilerComponent::updateActivity()
+{
+    profiler.setActive (isVisible() || chooser != nullptr);
+}
+
+void ProfilerComponent::timerCallback()
+{
+    if (profiler.getStats (stats, version))
+        repaint();
+}
+
+void ProfilerComponent::exportTrace()
+{
+    auto defaultFile = juce::File::getSpecialLocation (juce::File::userDocumentsDirectory)
+                           .getChildFile ("QwikRef trace " + juce::Time::getCurrentTime().formatted ("%Y-%m-%d %H-%M-%S") + ".json");
+
+    chooser = std::make_unique<juce::FileChooser> ("Export trace", defaultFile, "*.json");
+    updateActivity();
+
+    auto flags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::canSelectFiles
+               | juce::FileBrowserComponent::warnAboutOverwriting;
+
+    chooser->launchAsync (flags, [safeThis = juce::Component::SafePointer<ProfilerComponent> (this)] (const juce::FileChooser& fileChooser)
+    {
+        auto file = fileChooser.getResult();
+
+        if (safeThis == nullptr)
+            return;
+
+        if (file != juce::File())
+        {
+            safeThis->exportStatus = safeThis->profiler.exportTrace (file) ? "Trace saved" : "Export failed";
+            safeThis->repaint();
+
+            juce::Timer::callAfterDelay (3000, [safeThis]
+            {
+                if (safeThis != nullptr)
+                {
+                    safeThis->exportStatus = {};
+                    safeThis->repaint();
+                }
+            });
+        }
+
+        // The chooser can't be deleted from inside its own callback, so it goes once this one has returned.
+        juce::MessageManager::callAsync ([safeThis]
+        {
+            if (safeThis != nullptr)
+            {
+                safeThis->chooser.reset();
+                safeThis->updateActivity();
+            }
+        });
+    });
+}
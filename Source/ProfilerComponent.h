@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    ProfilerComponent.h
+
+    Collapsible panel with this instance's processBlock timing: min, mean,
+    p99 and max per block, the share of the block's duration that took, what
+    each stage costs, and the worst block since playback started broken
+    down by stage. It polls the profiler a few times a second while showing,
+    and can export the recent blocks as a Chrome/Perfetto trace. The
+    detailed history only runs while the panel is showing or an export is
+    pending; the overrun count and the worst block are kept all along.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "BlockProfiler.h"
+
+class ProfilerComponent  : public juce::Component,
+                           private juce::Timer
+{
+public:
+    explicit ProfilerComponent (BlockProfiler& profilerToShow);
+    ~ProfilerComponent() override;
+
+    void paint (juce::Graphics& g) override;
+    void resized() override;
+    void visibilityChanged() override;
+
+    // Called when the panel's collapse button is clicked; the editor decides what collapsing means.
+    std::function<void()> onCollapse;
+
+private:
+    void timerCallback() override;
+    void exportTrace();
+    void updateActivity();
+
+    BlockProfiler& profiler;
+    BlockProfiler::Stats stats;
+    juce::uint32 version { 0 };
+    juce::String exportStatus;
+
+    juce::TextButton exportButton { "Export" }, collapseButton { "-" };
+    std::unique_ptr<juce::FileChooser> chooser;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProfilerComponent)
+};
@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+    ResponseCurve.cpp
+
+  ==============================================================================
+*/
+
+#include "ResponseCurve.h"
+
+ResponseCurve::ResponseCurve (double minFrequency, double maxFrequency, float rangeDecibels) : range (rangeDecibels)
+{
+    // Log spaced, so every octave gets the same number of points across the width.
+    for (size_t i = 0; i < numPoints; ++i)
+        frequencies[i] = minFrequency * std::pow (maxFrequency / minFrequency, static_cast<double>(i) / (numPoints - 1));
+}
+
+const juce::Path& ResponseCurve::getPath (const Settings& settings, double sampleRate, juce::Rectangle<float> area)
+{
+    if (valid && settings == cachedSettings && sampleRate == cachedSampleRate && area == cachedArea)
+        return path;
+
+    cachedSettings = settings;
+    cachedSampleRate = sampleRate;
+    cachedArea = area;
+    valid = true;
+    path.clear();
+
+    if (sampleRate <= 0.0)
+        return path;
+
+    // The oversampled path designs its own bank at the higher rate, and prepare() is a no-op while that stays put.
+    auto renderRate = sampleRate * juce::jmax (1, settings.oversamplingFactor);
+    bank.prepare (renderRate);
+
+    // Points above the host's Nyquist have no meaning at this rate, so the curve stops there.
+    auto numValid = static_cast<size_t>(std::distance (frequencies.begin(),
+                                                       std::lower_bound (frequencies.begin(), frequencies.end(), sampleRate * 0.5)));
+
+    if (settings.morphing)
+    {
+        // The same blend SvfCascade::setTarget makes, taken from the same (matched or plain) profiles.
+        auto& from = settings.matched ? bank.getMatchedSvfProfile (settings.morphFrom) : bank.getSvfProfile (settings.morphFrom);
+        auto& to = settings.matched ? bank.getMatchedSvfProfile (settings.morphTo) : bank.getSvfProfile (settings.morphTo);
+        auto amount = static_cast<double>(settings.morphAmount);
+        auto mix = [amount] (double x, double y) { return x + amount * (y - x); };
+
+        SvfProfile blend;
+
+        for (size_t band = 0; band < numBands; ++band)
+            blend[band] = { mix (from[band].g, to[band].g), mix (from[band].k, to[band].k), mix (from[band].m0, to[band].m0),
+                            mix (from[band].m1, to[band].m1), mix (from[band].m2, to[band].m2) };
+
+        CoefficientBank::getMagnitudeForFrequencyArray (blend, renderRate, frequencies.data(), magnitudes.data(), numValid);
+    }
+    else
+    {
+        auto& profile = settings.matched ? bank.getMatchedProfile (settings.device) : bank.getProfile (settings.device);
+        CoefficientBank::getMagnitudeForFrequencyArray (profile, renderRate, frequencies.data(), magnitudes.data(), numValid);
+    }
+
+    for (size_t i = 0; i < numValid; ++i)
+    {
+        auto x = area.getX() + area.getWidth() * static_cast<float>(i) / static_cast<float>(numPoints - 1);
+        auto decibels = juce::jlimit (-range, range, juce::Decibels::gainToDecibels (static_cast<float>(magnitudes[i]), -range));
+        auto y = juce::jmap (decibels, -range, range, area.getBottom(), area.getY());
+
+        if (i == 0)
+            path.startNewSubPath (x, y);
+        else
+            path.lineTo (x, y);
+    }
+
+    return path;
+}
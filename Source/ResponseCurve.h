@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    ResponseCurve.h
+
+    The combined magnitude response of what the processor is rendering, as
+    a juce::Path ready to stroke. It evaluates the coefficient set actually
+    in use: the loudness-matched copy when static matching is on, the SVF
+    blend while morphing, and the bank designed at the oversampled rate on
+    that path. The measured path is drawn as the profile its IR stands in
+    for. The path is only rebuilt when the settings, the sample rate or the
+    drawing area change, so paint() just strokes it.
+
+    Message thread only: it keeps its own CoefficientBank rather than reading
+    the one the audio thread uses.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_gui_basics/juce_gui_basics.h>
+#include "CoefficientBank.h"
+
+class ResponseCurve
+{
+public:
+    // Which coefficients are running, as the processor sees it.
+    struct Settings
+    {
+        Device device { Device::flat };
+        bool matched { false };            // the pink-compensated copy, or the same gain applied after the render
+        bool morphing { false };
+        Device morphFrom { Device::flat }, morphTo { Device::flat };
+        float morphAmount { 0.f };
+        int oversamplingFactor { 1 };      // the cascades run at this multiple of the host rate
+
+        bool operator== (const Settings& other) const noexcept
+        {
+            return device == other.device && matched == other.matched && morphing == other.morphing
+                && morphFrom == other.morphFrom && morphTo == other.morphTo && morphAmount == other.morphAmount
+                && oversamplingFactor == other.oversamplingFactor;
+        }
+
+        bool operator!= (const Settings& other) const noexcept { return ! operator== (other); }
+    };
+
+    ResponseCurve (double minFrequency, double maxFrequency, float rangeDecibels);
+
+    const juce::Path& getPath (const Settings& settings, double sampleRate, juce::Rectangle<float> area);
+
+private:
+    static constexpr size_t numPoints = 256;
+
+    std::array<double, numPoints> frequencies {};
+    std::array<double, numPoints> magnitudes {};
+    float range;
+
+    CoefficientBank bank;
+    Settings cachedSettings;
+    double cachedSampleRate { 0.0 };
+    juce::Rectangle<float> cachedArea;
+    juce::Path path;
+    bool valid { false };
+};
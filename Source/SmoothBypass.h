@@ -0,0 +1,210 @@
+/*
+  ==============================================================================
+
+    SmoothBypass.h
+
+    Click-free bypass. The dry signal is kept in a ring delayed by the
+    plugin's latency, so it lines up with the wet path whether the host
+    compensates or not, and switching ramps a gain between the two.
+
+    Once a fade into bypass has finished the caller can stop rendering
+    altogether; process() is then a copy through the ring, or nothing at all
+    when there is no latency to cover. The ring isn't fed while the latency
+    is zero, so it starts from silence when latency comes back. When the
+    caller flushed its engines on the way back, holdDry() keeps the output
+    dry until they have latency's worth of real output, so the fade back
+    doesn't run into the silence they start with.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+template <typename SampleType>
+class SmoothBypass
+{
+public:
+    void prepare (double newSampleRate, int numChannels, int maximumBlockSize, int maximumLatency)
+    {
+        sampleRate = newSampleRate;
+        dryBuffer.setSize (numChannels, maximumBlockSize);
+        history.setSize (numChannels, maximumBlockSize + juce::jmax (1, maximumLatency));
+        setFadeTime (fadeMs);
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        history.clear();
+        writePosition = 0;
+        lastLatency = 0;
+        holdSamples = 0;
+        stateKnown = false;
+    }
+
+    void setFadeTime (float milliseconds) noexcept
+    {
+        fadeMs = milliseconds;
+        fadeLength = juce::jmax (1, static_cast<int>(sampleRate * milliseconds * 0.001));
+    }
+
+    // Sets where the fade is heading. The first call after a reset jumps straight there.
+    void setBypassed (bool shouldBypass) noexcept
+    {
+        auto target = shouldBypass ? 0 : fadeLength;
+
+        if (! stateKnown)
+        {
+            fadePosition = target;
+            stateKnown = true;
+        }
+
+        bypassed = shouldBypass;
+    }
+
+    // Keeps the output dry for the next 'numSamples' even once the fade back towards wet is due.
+    void holdDry (int numSamples) noexcept { holdSamples = juce::jmax (0, numSamples); }
+
+    // Nothing left to render: the fade has reached the dry side.
+    bool isFullyBypassed() const noexcept { return bypassed && fadePosition == 0; }
+
+    // Dry only, for blocks that skip rendering. Costs a copy through the ring when there's latency to match, otherwise nothing.
+    void process (const juce::dsp::AudioBlock<SampleType>& block, int latency) noexcept
+    {
+        followLatency (latency);
+
+        if (latency > 0)
+            delay (block, block, latency);
+    }
+
+    // Call before rendering: keeps the dry history up to date and holds on to the dry block if the mix needs it.
+    void capture (const juce::dsp::AudioBlock<SampleType>& block, int latency) noexcept
+    {
+        followLatency (latency);
+
+        auto needsDry = bypassed || fadePosition < fadeLength;
+
+        if (needsDry && latency > 0)
+            delay (block, getDryBlock (block), latency);
+        else if (needsDry)
+            getDryBlock (block).copyFrom (block);
+        else if (latency > 0)
+            writeHistory (block);
+    }
+
+    // Call after rendering: fades between the wet block and the dry one capture() kept.
+    void mix (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        if (! bypassed && fadePosition == fadeLength)
+            return;
+
+        auto dry = getDryBlock (block);
+        auto numSamples = static_cast<int>(dry.getNumSamples());
+        auto held = bypassed ? 0 : juce::jmin (numSamples, holdSamples);
+        holdSamples = bypassed ? 0 : holdSamples - held;
+
+        auto step = bypassed ? -1 : 1;
+        auto fadeSamples = juce::jmin (numSamples - held, bypassed ? fadePosition : fadeLength - fadePosition);
+        auto scale = static_cast<SampleType>(1) / static_cast<SampleType>(fadeLength);
+
+        for (size_t channel = 0; channel < dry.getNumChannels(); ++channel)
+        {
+            auto* wet = block.getChannelPointer (channel);
+            auto* source = dry.getChannelPointer (channel);
+            auto position = fadePosition;
+
+            std::copy (source, source + held, wet);
+
+            for (int i = held; i < held + fadeSamples; ++i)
+            {
+                position += step;
+                wet[i] = source[i] + static_cast<SampleType>(position) * scale * (wet[i] - source[i]);
+            }
+
+            // Past the end of a fade into bypass the rest of the block is dry.
+            if (bypassed)
+                std::copy (source + fadeSamples, source + numSamples, wet + fadeSamples);
+        }
+
+        fadePosition += step * fadeSamples;
+    }
+
+private:
+    // Whatever the ring holds from before a stretch at zero latency is stale, so it is silenced rather than
+    // replayed as the start of the delayed dry signal.
+    void followLatency (int latency) noexcept
+    {
+        if (latency > 0 && lastLatency == 0)
+        {
+            history.clear();
+            writePosition = 0;
+        }
+
+        lastLatency = latency;
+    }
+
+    juce::dsp::AudioBlock<SampleType> getDryBlock (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        jassert (block.getNumSamples() <= static_cast<size_t>(dryBuffer.getNumSamples()));
+
+        return juce::dsp::AudioBlock<SampleType> (dryBuffer)
+                   .getSubsetChannelBlock (0, juce::jmin (block.getNumChannels(), static_cast<size_t>(dryBuffer.getNumChannels())))
+                   .getSubBlock (0, juce::jmin (block.getNumSamples(), static_cast<size_t>(dryBuffer.getNumSamples())));
+    }
+
+    void writeHistory (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        auto size = history.getNumSamples();
+        auto numSamples = juce::jmin (static_cast<int>(block.getNumSamples()), size);
+        auto numChannels = juce::jmin (static_cast<int>(block.getNumChannels()), history.getNumChannels());
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* source = block.getChannelPointer (static_cast<size_t>(channel));
+            auto* ring = history.getWritePointer (channel);
+            auto first = juce::jmin (numSamples, size - writePosition);
+
+            std::copy (source, source + first, ring + writePosition);
+            std::copy (source + first, source + numSamples, ring);
+        }
+
+        writePosition = (writePosition + numSamples) % size;
+    }
+
+    // Writes input into the ring, then reads the same span back 'latency' samples late. Output may alias input.
+    void delay (const juce::dsp::AudioBlock<SampleType>& input, const juce::dsp::AudioBlock<SampleType>& output, int latency) noexcept
+    {
+        auto size = history.getNumSamples();
+        auto start = writePosition;
+        auto numSamples = juce::jmin (static_cast<int>(juce::jmin (input.getNumSamples(), output.getNumSamples())), size);
+        auto numChannels = juce::jmin (static_cast<int>(output.getNumChannels()), history.getNumChannels());
+
+        writeHistory (input);
+
+        auto readPosition = (start - juce::jlimit (0, size - numSamples, latency) + size) % size;
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* ring = history.getReadPointer (channel);
+            auto* destination = output.getChannelPointer (static_cast<size_t>(channel));
+            auto first = juce::jmin (numSamples, size - readPosition);
+
+            std::copy (ring + readPosition, ring + readPosition + first, destination);
+            std::copy (ring, ring + (numSamples - first), destination + first);
+        }
+    }
+
+    juce::AudioBuffer<SampleType> dryBuffer, history;
+    int writePosition { 0 };
+    int lastLatency { 0 };
+
+    double sampleRate { 44100.0 };
+    float fadeMs { 20.f };
+    int fadeLength { 1 };
+    int fadePosition { 0 };   // 0 is fully dry, fadeLength fully wet
+    int holdSamples { 0 };    // still to go before the fade towards wet may start
+    bool bypassed { false };
+    bool stateKnown { false };
+};
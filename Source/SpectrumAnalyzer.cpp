@@ -0,0 +1,140 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyzer.h"
+
+namespace
+{
+    // 75% overlap, and a power average that settles in roughly a quarter of a second.
+    constexpr int hopSize = SpectrumAnalyzer::fftSize / 4;
+    constexpr float smoothing = 0.75f;
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer() : juce::Thread ("QwikRef analyzer")
+{
+    for (auto& samples : history)
+        samples.assign (static_cast<size_t>(fftSize), 0.f);
+
+    fftData.assign (static_cast<size_t>(fftSize) * 2, 0.f);
+}
+
+SpectrumAnalyzer::~SpectrumAnalyzer()
+{
+    setActive (false);
+}
+
+void SpectrumAnalyzer::setActive (bool shouldBeActive)
+{
+    if (shouldBeActive)
+    {
+        if (! isThreadRunning())
+            startThread (juce::Thread::Priority::low);
+
+        active.store (true);
+    }
+    else
+    {
+        active.store (false);
+        stopThread (1000);
+    }
+}
+
+bool SpectrumAnalyzer::getSpectrum (Tap tap, Spectrum& destination, juce::uint32& version) const
+{
+    const juce::SpinLock::ScopedLockType lock (publishLock);
+
+    if (version == publishedVersion)
+        return false;
+
+    destination = published[static_cast<size_t>(tap)];
+    version = publishedVersion;
+    return true;
+}
+
+void SpectrumAnalyzer::run()
+{
+    // Whatever is still queued from the last time the editor was open is stale.
+    drain();
+
+    for (auto& samples : history)
+        std::fill (samples.begin(), samples.end(), 0.f);
+
+    for (auto& average : averages)
+        average.fill (0.f);
+
+    pending.fill (0);
+
+    while (! threadShouldExit())
+    {
+        for (size_t tap = 0; tap < rings.size(); ++tap)
+            analyse (tap);
+
+        wait (10);
+    }
+}
+
+void SpectrumAnalyzer::drain()
+{
+    for (auto& ring : rings)
+        ring.fifo.finishedRead (ring.fifo.getNumReady());
+}
+
+void SpectrumAnalyzer::analyse (size_t tap)
+{
+    auto& ring = rings[tap];
+    auto& samples = history[tap];
+    auto hasNewFrame = false;
+
+    while (ring.fifo.getNumReady() > 0)
+    {
+        // Slide the newest samples in, at most up to the next hop.
+        auto numToRead = juce::jmin (ring.fifo.getNumReady(), hopSize - pending[tap]);
+
+        int start1, size1, start2, size2;
+        ring.fifo.prepareToRead (numToRead, start1, size1, start2, size2);
+
+        std::move (samples.begin() + numToRead, samples.end(), samples.begin());
+        auto tail = samples.end() - numToRead;
+        tail = std::copy_n (ring.samples.begin() + start1, size1, tail);
+        std::copy_n (ring.samples.begin() + start2, size2, tail);
+
+        ring.fifo.finishedRead (size1 + size2);
+        pending[tap] += numToRead;
+
+        if (pending[tap] < hopSize)
+            continue;
+
+        pending[tap] = 0;
+
+        std::copy (samples.begin(), samples.end(), fftData.begin());
+        window.multiplyWithWindowingTable (fftData.data(), static_cast<size_t>(fftSize));
+        fft.performFrequencyOnlyForwardTransform (fftData.data(), true);
+
+        // A full scale sine peaks at fftSize / 4 through a Hann window, so that reads as 0 dB.
+        auto& average = averages[tap];
+        const auto scale = 4.f / static_cast<float>(fftSize);
+
+        for (size_t bin = 0; bin < average.size(); ++bin)
+        {
+            auto magnitude = fftData[bin] * scale;
+            average[bin] = smoothing * average[bin] + (1.f - smoothing) * magnitude * magnitude;
+        }
+
+        hasNewFrame = true;
+    }
+
+    if (! hasNewFrame)
+        return;
+
+    const juce::SpinLock::ScopedLockType lock (publishLock);
+
+    for (size_t bin = 0; bin < averages[tap].size(); ++bin)
+        published[tap][bin] = juce::Decibels::gainToDecibels (std::sqrt (averages[tap][bin]), -120.f);
+
+    ++publishedVersion;
+}
@@ -0,0 +1,108 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyzer.h
+
+    Pre/post spectrum for the editor. The audio thread mono-sums each tap into
+    a single-producer/single-consumer ring; a background thread windows,
+    transforms and averages it, and the editor polls the result on a timer.
+
+    While no editor is open the thread is stopped and push() returns after a
+    single relaxed atomic load.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+
+class SpectrumAnalyzer  : private juce::Thread
+{
+public:
+    enum class Tap { pre, post, numTaps };
+
+    static constexpr int numTaps = static_cast<int>(Tap::numTaps);
+    static constexpr int fftOrder = 12;
+    static constexpr int fftSize = 1 << fftOrder;
+    static constexpr int numBins = fftSize / 2 + 1;
+
+    using Spectrum = std::array<float, numBins>;
+
+    SpectrumAnalyzer();
+    ~SpectrumAnalyzer() override;
+
+    // Called from prepareToPlay; the editor reads it back to place bins on the frequency axis.
+    void setSampleRate (double newSampleRate) noexcept { sampleRate.store (newSampleRate); }
+    double getSampleRate() const noexcept { return sampleRate.load(); }
+
+    // Message thread: the editor switches the analyzer on while it is showing.
+    void setActive (bool shouldBeActive);
+
+    // Audio thread: never blocks or allocates. Samples that don't fit are dropped.
+    template <typename SampleType>
+    void push (Tap tap, const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        if (! active.load (std::memory_order_relaxed) || block.getNumChannels() == 0)
+            return;
+
+        auto& ring = rings[static_cast<size_t>(tap)];
+        auto numSamples = static_cast<int>(block.getNumSamples());
+        auto gain = 1.f / static_cast<float>(block.getNumChannels());
+
+        int start1, size1, start2, size2;
+        ring.fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+
+        auto write = [&] (int destination, int source, int count)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                auto sum = 0.f;
+
+                for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+                    sum += static_cast<float>(block.getSample (static_cast<int>(channel), source + i));
+
+                ring.samples[static_cast<size_t>(destination + i)] = sum * gain;
+            }
+        };
+
+        write (start1, 0, size1);
+        write (start2, size1, size2);
+        ring.fifo.finishedWrite (size1 + size2);
+    }
+
+    // Message thread: copies the latest averaged spectrum (in dB per bin) if it changed since 'version'.
+    bool getSpectrum (Tap tap, Spectrum& destination, juce::uint32& version) const;
+
+private:
+    void run() override;
+    void drain();
+    void analyse (size_t tap);
+
+    struct Ring
+    {
+        static constexpr int capacity = fftSize * 8;
+
+        juce::AbstractFifo fifo { capacity };
+        std::vector<float> samples = std::vector<float> (static_cast<size_t>(capacity));
+    };
+
+    std::array<Ring, numTaps> rings;
+    std::atomic<bool> active { false };
+    std::atomic<double> sampleRate { 44100.0 };
+
+    // Owned by the analysis thread.
+    juce::dsp::FFT fft { fftOrder };
+    juce::dsp::WindowingFunction<float> window { static_cast<size_t>(fftSize), juce::dsp::WindowingFunction<float>::hann, false };
+    std::array<std::vector<float>, numTaps> history;
+    std::array<int, numTaps> pending {};
+    std::vector<float> fftData;
+    std::array<Spectrum, numTaps> averages {};
+
+    // Shared with the message thread; neither side is the audio thread, so a lock is fine here.
+    mutable juce::SpinLock publishLock;
+    std::array<Spectrum, numTaps> published {};
+    juce::uint32 publishedVersion { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyzer)
+};
@@ -0,0 +1,177 @@
+/*
+  ==============================================================================
+
+    SvfCascade.h
+
+    Five TPT state variable filters in series, used for morphing between two
+    device profiles. Parameters glide linearly towards their target a sample
+    at a time, which the SVF structure tolerates without going unstable.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_dsp/juce_dsp.h>
+#include "CoefficientBank.h"
+
+template <typename SampleType>
+class SvfCascade
+{
+public:
+    void prepare (double sampleRate, int numChannels)
+    {
+        state.assign (static_cast<size_t>(numChannels), {});
+        rampLength = juce::jmax (1, static_cast<int>(sampleRate * 0.005));
+        rampRemaining = 0;
+        hasTarget = false;
+    }
+
+    void reset() noexcept
+    {
+        for (auto& channel : state)
+            channel.fill ({});
+
+        hasTarget = false;
+    }
+
+    // Points the cascade at the mix of two profiles. The first target after a reset is applied immediately,
+    // later ones are glided to over a few milliseconds.
+    void setTarget (const SvfProfile& from, const SvfProfile& to, SampleType amount) noexcept
+    {
+        for (size_t band = 0; band < numBands; ++band)
+        {
+            auto& a = from[band];
+            auto& b = to[band];
+            auto mix = [amount] (double x, double y) { return static_cast<SampleType>(x + static_cast<double>(amount) * (y - x)); };
+
+            target[band] = { mix (a.g, b.g), mix (a.k, b.k), mix (a.m0, b.m0), mix (a.m1, b.m1), mix (a.m2, b.m2) };
+        }
+
+        if (! hasTarget)
+        {
+            current = target;
+            rampRemaining = 0;
+            hasTarget = true;
+
+            for (auto& params : current)
+                updateGains (params);
+
+            return;
+        }
+
+        for (size_t band = 0; band < numBands; ++band)
+        {
+            auto& c = current[band];
+            auto& t = target[band];
+            auto scale = static_cast<SampleType>(1) / static_cast<SampleType>(rampLength);
+
+            step[band] = { (t.g - c.g) * scale, (t.k - c.k) * scale, (t.m0 - c.m0) * scale,
+                           (t.m1 - c.m1) * scale, (t.m2 - c.m2) * scale };
+        }
+
+        rampRemaining = rampLength;
+    }
+
+    void process (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+    {
+        auto numChannels = juce::jmin (block.getNumChannels(), state.size());
+        auto numSamples = block.getNumSamples();
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            if (rampRemaining > 0)
+                advanceRamp();
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                auto* data = block.getChannelPointer (channel);
+                auto& bands = state[channel];
+                auto x = data[i];
+
+                for (size_t band = 0; band < numBands; ++band)
+                {
+                    auto& p = current[band];
+                    auto& s = bands[band];
+
+                    auto v3 = x - s.ic2;
+                    auto v1 = p.a1 * s.ic1 + p.a2 * v3;
+                    auto v2 = s.ic2 + p.a2 * s.ic1 + p.a3 * v3;
+                    s.ic1 = 2 * v1 - s.ic1;
+                    s.ic2 = 2 * v2 - s.ic2;
+
+                    x = p.m0 * x + p.m1 * v1 + p.m2 * v2;
+                }
+
+                data[i] = x;
+            }
+        }
+
+        for (auto& bands : state)
+        {
+            for (auto& s : bands)
+            {
+                juce::dsp::util::snapToZero (s.ic1);
+                juce::dsp::util::snapToZero (s.ic2);
+            }
+        }
+    }
+
+private:
+    struct Params
+    {
+        SampleType g, k, m0, m1, m2;
+        SampleType a1 { 1 }, a2 { 0 }, a3 { 0 };
+    };
+
+    struct Delta
+    {
+        SampleType g, k, m0, m1, m2;
+    };
+
+    struct State
+    {
+        SampleType ic1 { 0 }, ic2 { 0 };
+    };
+
+    static void updateGains (Params& p) noexcept
+    {
+        p.a1 = static_cast<SampleType>(1) / (1 + p.g * (p.g + p.k));
+        p.a2 = p.g * p.a1;
+        p.a3 = p.g * p.a2;
+    }
+
+    void advanceRamp() noexcept
+    {
+        if (--rampRemaining == 0)
+        {
+            current = target;
+
+            for (auto& params : current)
+                updateGains (params);
+
+            return;
+        }
+
+        for (size_t band = 0; band < numBands; ++band)
+        {
+            auto& p = current[band];
+            auto& d = step[band];
+
+            p.g += d.g;
+            p.k += d.k;
+            p.m0 += d.m0;
+            p.m1 += d.m1;
+            p.m2 += d.m2;
+            updateGains (p);
+        }
+    }
+
+    std::array<Params, numBands> current {}, target {};
+    std::array<Delta, numBands> step {};
+    std::vector<std::array<State, numBands>> state;
+
+    int rampLength { 1 };
+    int rampRemaining { 0 };
+    bool hasTarget { false };
+};
@@ -0,0 +1,337 @@
+/*
+  ==============================================================================
+
+    RealtimeChecker.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeChecker.h"
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#include <numeric>
+#include <utility>
+
+#if defined (__GLIBC__)
+ #include <dlfcn.h>
+ #include <pthread.h>
+ #include <time.h>
+ #include <unistd.h>
+ #define QWIKREF_INTERPOSE_GLIBC 1
+
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void __libc_free (void*);
+}
+#else
+ #define QWIKREF_INTERPOSE_GLIBC 0
+#endif
+
+#if JUCE_WINDOWS
+ #include <malloc.h>
+#endif
+
+namespace RealtimeChecker
+{
+    namespace
+    {
+        thread_local int realtimeDepth = 0;
+        thread_local bool reporting = false;
+        thread_local std::array<int, numViolations> allowed {};
+
+        std::array<std::atomic<int>, numViolations> counts {};
+        juce::String firstCall, firstTrace;
+
+        void flag (Violation violation, const char* call) noexcept
+        {
+            if (realtimeDepth == 0 || reporting)
+                return;
+
+            if (auto& remaining = allowed[static_cast<size_t>(violation)]; remaining > 0)
+            {
+                --remaining;
+                return;
+            }
+
+            // Recording a violation allocates too, so nothing in here gets flagged.
+            reporting = true;
+            counts[static_cast<size_t>(violation)].fetch_add (1);
+
+            if (firstCall.isEmpty())
+            {
+                firstCall = call;
+                firstTrace = juce::SystemStats::getStackBacktrace();
+            }
+
+            reporting = false;
+        }
+
+        void* allocate (size_t size) noexcept
+        {
+           #if QWIKREF_INTERPOSE_GLIBC
+            return __libc_malloc (size == 0 ? 1 : size);
+           #else
+            return std::malloc (size == 0 ? 1 : size);
+           #endif
+        }
+
+        void* allocateAligned (size_t size, size_t alignment) noexcept
+        {
+            size = size == 0 ? 1 : size;
+
+           #if QWIKREF_INTERPOSE_GLIBC
+            return __libc_memalign (alignment, size);
+           #elif JUCE_WINDOWS
+            return _aligned_malloc (size, alignment);
+           #else
+            void* memory = nullptr;
+            return posix_memalign (&memory, juce::jmax (alignment, sizeof (void*)), size) == 0 ? memory : nullptr;
+           #endif
+        }
+
+        void release (void* memory) noexcept
+        {
+            if (memory == nullptr)
+                return;
+
+            flag (Violation::deallocation, "operator delete");
+
+           #if QWIKREF_INTERPOSE_GLIBC
+            __libc_free (memory);
+           #else
+            std::free (memory);
+           #endif
+        }
+
+        void releaseAligned (void* memory) noexcept
+        {
+            if (memory == nullptr)
+                return;
+
+            flag (Violation::deallocation, "operator delete (aligned)");
+
+           #if QWIKREF_INTERPOSE_GLIBC
+            __libc_free (memory);
+           #elif JUCE_WINDOWS
+            _aligned_free (memory);
+           #else
+            std::free (memory);
+           #endif
+        }
+
+        void* allocateOrThrow (size_t size, const char* call)
+        {
+            flag (Violation::allocation, call);
+
+            if (auto* memory = allocate (size))
+                return memory;
+
+            throw std::bad_alloc();
+        }
+
+        void* allocateAlignedOrThrow (size_t size, std::align_val_t alignment, const char* call)
+        {
+            flag (Violation::allocation, call);
+
+            if (auto* memory = allocateAligned (size, static_cast<size_t>(alignment)))
+                return memory;
+
+            throw std::bad_alloc();
+        }
+    }
+
+    const char* getName (Violation violation) noexcept
+    {
+        switch (violation)
+        {
+            case Violation::allocation:   return "allocation";
+            case Violation::deallocation: return "deallocation";
+            case Violation::lock:         return "lock";
+            case Violation::systemCall:   return "system call";
+            case Violation::numViolations:
+            default:                      return "unknown";
+        }
+    }
+
+    ScopedRealtimeSection::ScopedRealtimeSection() noexcept   { ++realtimeDepth; }
+    ScopedRealtimeSection::~ScopedRealtimeSection() noexcept  { --realtimeDepth; }
+
+    ScopedAllowance::ScopedAllowance (Violation violationToAllow, int count) noexcept
+        : violation (violationToAllow), previous (allowed[static_cast<size_t>(violation)])
+    {
+        allowed[static_cast<size_t>(violation)] = count;
+    }
+
+    ScopedAllowance::~ScopedAllowance() noexcept
+    {
+        allowed[static_cast<size_t>(violation)] = previous;
+    }
+
+    int Report::getTotal() const noexcept
+    {
+        return std::accumulate (counts.begin(), counts.end(), 0);
+    }
+
+    Report takeReport()
+    {
+        jassert (realtimeDepth == 0);
+
+        Report report;
+
+        for (size_t i = 0; i < counts.size(); ++i)
+            report.counts[i] = counts[i].exchange (0);
+
+        report.firstCall = std::exchange (firstCall, {});
+        report.firstTrace = std::exchange (firstTrace, {});
+        return report;
+    }
+}
+
+using RealtimeChecker::Violation;
+
+//==============================================================================
+void* operator new (std::size_t size)                                 { return RealtimeChecker::allocateOrThrow (size, "operator new"); }
+void* operator new[] (std::size_t size)                               { return RealtimeChecker::allocateOrThrow (size, "operator new[]"); }
+void* operator new (std::size_t size, std::align_val_t alignment)     { return RealtimeChecker::allocateAlignedOrThrow (size, alignment, "operator new (aligned)"); }
+void* operator new[] (std::size_t size, std::align_val_t alignment)   { return RealtimeChecker::allocateAlignedOrThrow (size, alignment, "operator new[] (aligned)"); }
+
+void* operator new (std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeChecker::flag (Violation::allocation, "operator new (nothrow)");
+    return RealtimeChecker::allocate (size);
+}
+
+void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept
+{
+    RealtimeChecker::flag (Violation::allocation, "operator new[] (nothrow)");
+    return RealtimeChecker::allocate (size);
+}
+
+void* operator new (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    RealtimeChecker::flag (Violation::allocation, "operator new (aligned, nothrow)");
+    return RealtimeChecker::allocateAligned (size, static_cast<size_t>(alignment));
+}
+
+void* operator new[] (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    RealtimeChecker::flag (Violation::allocation, "operator new[] (aligned, nothrow)");
+    return RealtimeChecker::allocateAligned (size, static_cast<size_t>(alignment));
+}
+
+void operator delete (void* memory) noexcept                                          { RealtimeChecker::release (memory); }
+void operator delete[] (void* memory) noexcept                                        { RealtimeChecker::release (memory); }
+void operator delete (void* memory, std::size_t) noexcept                             { RealtimeChecker::release (memory); }
+void operator delete[] (void* memory, std::size_t) noexcept                           { RealtimeChecker::release (memory); }
+void operator delete (void* memory, const std::nothrow_t&) noexcept                   { RealtimeChecker::release (memory); }
+void operator delete[] (void* memory, const std::nothrow_t&) noexcept                 { RealtimeChecker::release (memory); }
+void operator delete (void* memory, std::align_val_t) noexcept                        { RealtimeChecker::releaseAligned (memory); }
+void operator delete[] (void* memory, std::align_val_t) noexcept                      { RealtimeChecker::releaseAligned (memory); }
+void operator delete (void* memory, std::size_t, std::align_val_t) noexcept           { RealtimeChecker::releaseAligned (memory); }
+void operator delete[] (void* memory, std::size_t, std::align_val_t) noexcept         { RealtimeChecker::releaseAligned (memory); }
+void operator delete (void* memory, std::align_val_t, const std::nothrow_t&) noexcept { RealtimeChecker::releaseAligned (memory); }
+void operator delete[] (void* memory, std::align_val_t, const std::nothrow_t&) noexcept { RealtimeChecker::releaseAligned (memory); }
+
+//==============================================================================
+#if QWIKREF_INTERPOSE_GLIBC
+// JUCE's HeapBlock and plenty of C code allocate with malloc directly, and locks and sleeps go through
+// libc/libpthread. Defining these in the executable puts them in front of glibc's; the real ones are
+// reached through the __libc_* entry points or dlsym(RTLD_NEXT).
+namespace
+{
+    template <typename Function>
+    Function getNext (std::atomic<void*>& cache, const char* name) noexcept
+    {
+        auto* function = cache.load (std::memory_order_relaxed);
+
+        if (function == nullptr)
+        {
+            function = dlsym (RTLD_NEXT, name);
+            cache.store (function, std::memory_order_relaxed);
+        }
+
+        return reinterpret_cast<Function> (function);
+    }
+
+    std::atomic<void*> nextMutexLock { nullptr }, nextReadLock { nullptr }, nextWriteLock { nullptr };
+    std::atomic<void*> nextNanosleep { nullptr }, nextUsleep { nullptr };
+}
+
+extern "C"
+{
+    void* malloc (size_t size) __THROW
+    {
+        RealtimeChecker::flag (Violation::allocation, "malloc");
+        return __libc_malloc (size);
+    }
+
+    void* calloc (size_t count, size_t size) __THROW
+    {
+        RealtimeChecker::flag (Violation::allocation, "calloc");
+        return __libc_calloc (count, size);
+    }
+
+    void* realloc (void* memory, size_t size) __THROW
+    {
+        RealtimeChecker::flag (Violation::allocation, "realloc");
+        return __libc_realloc (memory, size);
+    }
+
+    void free (void* memory) __THROW
+    {
+        if (memory != nullptr)
+            RealtimeChecker::flag (Violation::deallocation, "free");
+
+        __libc_free (memory);
+    }
+
+    int posix_memalign (void** memory, size_t alignment, size_t size) __THROW
+    {
+        RealtimeChecker::flag (Violation::allocation, "posix_memalign");
+        *memory = __libc_memalign (alignment, size);
+        return *memory != nullptr ? 0 : ENOMEM;
+    }
+
+    void* aligned_alloc (size_t alignment, size_t size) __THROW
+    {
+        RealtimeChecker::flag (Violation::allocation, "aligned_alloc");
+        return __libc_memalign (alignment, size);
+    }
+
+    int pthread_mutex_lock (pthread_mutex_t* mutex) __THROWNL
+    {
+        RealtimeChecker::flag (Violation::lock, "pthread_mutex_lock");
+        return getNext<int (*) (pthread_mutex_t*)> (nextMutexLock, "pthread_mutex_lock") (mutex);
+    }
+
+    int pthread_rwlock_rdlock (pthread_rwlock_t* lock) __THROWNL
+    {
+        RealtimeChecker::flag (Violation::lock, "pthread_rwlock_rdlock");
+        return getNext<int (*) (pthread_rwlock_t*)> (nextReadLock, "pthread_rwlock_rdlock") (lock);
+    }
+
+    int pthread_rwlock_wrlock (pthread_rwlock_t* lock) __THROWNL
+    {
+        RealtimeChecker::flag (Violation::lock, "pthread_rwlock_wrlock");
+        return getNext<int (*) (pthread_rwlock_t*)> (nextWriteLock, "pthread_rwlock_wrlock") (lock);
+    }
+
+    int nanosleep (const struct timespec* requested, struct timespec* remaining)
+    {
+        RealtimeChecker::flag (Violation::systemCall, "nanosleep");
+        return getNext<int (*) (const struct timespec*, struct timespec*)> (nextNanosleep, "nanosleep") (requested, remaining);
+    }
+
+    int usleep (useconds_t microseconds)
+    {
+        RealtimeChecker::flag (Violation::systemCall, "usleep");
+        return getNext<int (*) (useconds_t)> (nextUsleep, "usleep") (microseconds);
+    }
+}
+#endif
@@ -0,0 +1,65 @@
+/*
+  ==============================================================================
+
+    RealtimeChecker.h
+
+    Test-build instrumentation for audio-thread safety. Linking
+    RealtimeChecker.cpp into an executable replaces the global operator
+    new/delete (and, on glibc, malloc/free, pthread mutex and rwlock
+    acquisition and sleeps), so each of them is counted while the calling
+    thread is inside a ScopedRealtimeSection.
+
+    Never link it into the plugin itself. It assumes only one thread at a
+    time enters a realtime section, which is how the test drives
+    processBlock.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+
+namespace RealtimeChecker
+{
+    enum class Violation { allocation, deallocation, lock, systemCall, numViolations };
+
+    constexpr int numViolations = static_cast<int>(Violation::numViolations);
+
+    const char* getName (Violation violation) noexcept;
+
+    // Everything the current thread does while one of these is alive is held to realtime rules.
+    struct ScopedRealtimeSection
+    {
+        ScopedRealtimeSection() noexcept;
+        ~ScopedRealtimeSection() noexcept;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtimeSection)
+    };
+
+    // Lets the next 'count' violations of one kind through on the current thread, for code the plugin has
+    // to call but doesn't own. Anything past that count is flagged as usual.
+    struct ScopedAllowance
+    {
+        ScopedAllowance (Violation violationToAllow, int count) noexcept;
+        ~ScopedAllowance() noexcept;
+
+        const Violation violation;
+        const int previous;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedAllowance)
+    };
+
+    struct Report
+    {
+        std::array<int, numViolations> counts {};
+        juce::String firstCall;    // what the first violation was
+        juce::String firstTrace;   // and where it came from
+
+        int getTotal() const noexcept;
+    };
+
+    // Returns what was caught since the last call and starts counting again.
+    Report takeReport();
+}
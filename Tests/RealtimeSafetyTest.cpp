@@ -0,0 +1,653 @@
+/*
+  ==============================================================================
+
+    RealtimeSafetyTest.cpp
+
+    Drives headless QwikRefAudioProcessors through every parameter value and
+    every profile, render-path, bypass and sleep transition while
+    RealtimeChecker watches processBlock. The processors run on their own
+    thread, the way a host's audio thread runs them, while the main thread
+    runs the message loop. Most parameters change from the message thread,
+    outside the realtime section; automation changes them inside it,
+    between blocks, and the listeners it reaches are held to realtime rules
+    too. Exits with 1 if anything allocated, locked or slept on the audio
+    thread.
+
+    JUCE holds one lock while it notifies a parameter's listeners, whichever
+    plugin it is in, so exactly that lock is let through while automating.
+    A listener that locks after it is still reported, and the test checks
+    that it is.
+
+    Usage: QwikRefRealtimeTest
+
+  ==============================================================================
+*/
+
+#include <iostream>
+#include <numeric>
+#include "../Source/PluginProcessor.h"
+#include "RealtimeChecker.h"
+
+namespace
+{
+    constexpr double sampleRate = 48000.0;
+    constexpr int maximumBlockSize = 512;
+
+    // What hosts hand us, including the odd sizes that take the scalar tails and split sub-blocks.
+    constexpr std::array<int, 5> blockSizes { 512, 1, 17, 256, 512 };
+
+    // Long enough for the processor's timer to pick up anything automation left for the message thread.
+    constexpr int settleTimeMs = 150;
+
+    // Runs 'function' on the message thread and waits for it to return, the way a host's UI hands a change over.
+    template <typename Function>
+    void callOnMessageThread (Function&& function)
+    {
+        using FunctionType = std::remove_reference_t<Function>;
+
+        juce::MessageManager::getInstance()->callFunctionOnMessageThread ([] (void* context) -> void*
+        {
+            (*static_cast<FunctionType*>(context))();
+            return nullptr;
+        }, std::addressof (function));
+    }
+
+    template <typename SampleType>
+    class RealtimeSafetyTest
+    {
+    public:
+        RealtimeSafetyTest (const juce::String& configurationName, const juce::AudioChannelSet& layout, bool withDeviceOutputs)
+            : name (configurationName)
+        {
+            auto buses = processor.getBusesLayout();
+            buses.getChannelSet (true, 0) = layout;
+            buses.getChannelSet (false, 0) = layout;
+
+            for (int bus = 1; bus < buses.outputBuses.size(); ++bus)
+                buses.outputBuses.getReference (bus) = withDeviceOutputs ? layout : juce::AudioChannelSet::disabled();
+
+            supported = processor.setBusesLayout (buses);
+
+            processor.setProcessingPrecision (std::is_same_v<SampleType, double> ? juce::AudioProcessor::doublePrecision
+                                                                                  : juce::AudioProcessor::singlePrecision);
+            processor.setRateAndBufferSizeDetails (sampleRate, maximumBlockSize);
+            processor.prepareToPlay (sampleRate, maximumBlockSize);
+
+            // Every block the test hands over is a view into one buffer, made here so the test itself never allocates.
+            auto numChannels = juce::jmax (processor.getTotalNumInputChannels(), processor.getTotalNumOutputChannels());
+            auto totalSamples = std::accumulate (blockSizes.begin(), blockSizes.end(), 0);
+
+            noise.setSize (numChannels, totalSamples);
+            work.setSize (numChannels, totalSamples);
+
+            juce::Random random (0x51f7);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+                for (int i = 0; i < totalSamples; ++i)
+                    noise.setSample (channel, i, static_cast<SampleType>(random.nextFloat() - 0.5f));
+
+            views.reserve (blockSizes.size());
+            auto offset = 0;
+
+            for (auto blockSize : blockSizes)
+            {
+                views.emplace_back (work.getArrayOfWritePointers(), numChannels, offset, blockSize);
+                offset += blockSize;
+            }
+        }
+
+        ~RealtimeSafetyTest()
+        {
+            processor.releaseResources();
+        }
+
+        // Returns the number of steps that broke realtime rules.
+        int run()
+        {
+            if (! supported)
+            {
+                std::cerr << name << ": layout not supported" << std::endl;
+                return 1;
+            }
+
+            resetParameters();
+            process ("first blocks after prepare");
+
+            sweepParameters();
+            sweepDevices();
+            sweepMorph();
+            sweepOversampling();
+            sweepFanOut();
+            sweepConvolution ("linearPhase");
+            sweepConvolution ("measured");
+            sweepChannelOptions();
+            sweepLoudnessMatch();
+            sweepBypass();
+            sweepSleep();
+            sweepProgramChanges();
+            sweepAutomation();
+
+            std::cout << name << ": " << numSteps << " steps, "
+                      << (failedSteps.isEmpty() ? juce::String ("all realtime safe")
+                                                : juce::String (failedSteps.size()) + " failed") << std::endl;
+
+            return failedSteps.size();
+        }
+
+    private:
+        enum class Input { noise, silence, garbage };
+
+        void process (const juce::String& step, Input input = Input::noise, bool hostBypassed = false)
+        {
+            fill (input);
+
+            {
+                RealtimeChecker::ScopedRealtimeSection realtime;
+
+                for (auto& view : views)
+                {
+                    if (hostBypassed)
+                        processor.processBlockBypassed (view, midi);
+                    else
+                        processor.processBlock (view, midi);
+                }
+            }
+
+            check (step, RealtimeChecker::takeReport());
+        }
+
+        void fill (Input input)
+        {
+            if (input == Input::silence)
+            {
+                work.clear();
+                return;
+            }
+
+            for (int channel = 0; channel < work.getNumChannels(); ++channel)
+                work.copyFrom (channel, 0, noise, channel, 0, work.getNumSamples());
+
+            if (input == Input::garbage)
+            {
+                work.setSample (0, 3, std::numeric_limits<SampleType>::quiet_NaN());
+                work.setSample (work.getNumChannels() - 1, work.getNumSamples() / 2, std::numeric_limits<SampleType>::infinity());
+            }
+        }
+
+        using Automation = std::vector<std::pair<juce::String, float>>;
+
+        // One change before each block, all inside the realtime section. The blocks after it are then
+        // processed again once the message thread has had time to apply whatever was left for it.
+        void processAutomated (const juce::String& step, const Automation& automation)
+        {
+            fill (Input::noise);
+
+            {
+                RealtimeChecker::ScopedRealtimeSection realtime;
+                auto change = automation.begin();
+
+                for (auto& view : views)
+                {
+                    if (change != automation.end())
+                    {
+                        automate (change->first, change->second);
+                        ++change;
+                    }
+
+                    processor.processBlock (view, midi);
+                }
+            }
+
+            check (step, RealtimeChecker::takeReport());
+
+            juce::Thread::sleep (settleTimeMs);
+            process (step + ", applied");
+        }
+
+        void check (const juce::String& step, const RealtimeChecker::Report& report)
+        {
+            ++numSteps;
+
+            if (report.getTotal() == 0 || failedSteps.contains (step))
+                return;
+
+            failedSteps.add (step);
+
+            std::cout << "FAILED " << name << ", " << step << ":";
+
+            for (int i = 0; i < RealtimeChecker::numViolations; ++i)
+                if (report.counts[static_cast<size_t>(i)] > 0)
+                    std::cout << " " << report.counts[static_cast<size_t>(i)] << " x "
+                              << RealtimeChecker::getName (static_cast<RealtimeChecker::Violation>(i));
+
+            std::cout << std::endl << "  first: " << report.firstCall << std::endl
+                      << report.firstTrace << std::endl;
+        }
+
+        //==============================================================================
+        void set (const juce::String& parameterID, float value)
+        {
+            auto* parameter = processor.apvts.getParameter (parameterID);
+            callOnMessageThread ([parameter, value] { parameter->setValueNotifyingHost (parameter->convertTo0to1 (value)); });
+        }
+
+        // What a host does with automation on the audio thread. AudioProcessorParameter holds its listener lock
+        // while it calls any listener at all, so that one lock is let through; every listener it reaches,
+        // ours included, is checked from there on.
+        void automate (const juce::String& parameterID, float value)
+        {
+            auto* parameter = processor.apvts.getParameter (parameterID);
+            auto normalised = parameter->convertTo0to1 (value);
+
+            parameter->setValue (normalised);
+
+            RealtimeChecker::ScopedAllowance listenerLock (RealtimeChecker::Violation::lock, 1);
+            parameter->sendValueChangedMessageToListeners (normalised);
+        }
+
+        void setDevice (Device device)
+        {
+            for (auto& profile : deviceProfiles)
+                if (hasParameter (profile))
+                    set (profile.parameterID, profile.device == device ? 1.f : 0.f);
+        }
+
+        void resetParameters()
+        {
+            callOnMessageThread ([this]
+            {
+                for (auto* parameter : processor.getParameters())
+                    parameter->setValueNotifyingHost (parameter->getDefaultValue());
+            });
+
+            set ("power", 0.f);
+            midi.clear();
+        }
+
+        static juce::Array<Device> getDevices()
+        {
+            juce::Array<Device> devices;
+
+            for (auto& profile : deviceProfiles)
+                if (hasParameter (profile))
+                    devices.add (profile.device);
+
+            return devices;
+        }
+
+        static juce::String getDeviceName (Device device)
+        {
+            return getDeviceProfile (device).parameterID;
+        }
+
+        //==============================================================================
+        // Every value of every switch and choice, and both ends and the middle of every continuous parameter.
+        void sweepParameters()
+        {
+            for (auto* parameter : processor.getParameters())
+            {
+                auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+
+                if (ranged == nullptr)
+                    continue;
+
+                resetParameters();
+
+                juce::Array<float> values { 0.f, 0.5f, 1.f };
+
+                if (dynamic_cast<juce::AudioParameterBool*>(ranged) != nullptr || dynamic_cast<juce::AudioParameterChoice*>(ranged) != nullptr)
+                {
+                    values.clear();
+
+                    for (int i = 0; i < ranged->getNumSteps(); ++i)
+                        values.add (static_cast<float>(i) / static_cast<float>(juce::jmax (1, ranged->getNumSteps() - 1)));
+                }
+
+                for (auto value : values)
+                {
+                    callOnMessageThread ([ranged, value] { ranged->setValueNotifyingHost (value); });
+                    process (ranged->getParameterID() + " = " + ranged->getCurrentValueAsText());
+                }
+            }
+        }
+
+        // Every device to every other device, with instant and slow crossfades.
+        void sweepDevices()
+        {
+            resetParameters();
+
+            for (auto crossfade : { 0.f, 250.f })
+            {
+                set ("crossfade", crossfade);
+
+                for (auto from : getDevices())
+                {
+                    for (auto to : getDevices())
+                    {
+                        setDevice (from);
+                        process (getDeviceName (from));
+                        setDevice (to);
+                        process (getDeviceName (from) + " -> " + getDeviceName (to) + ", crossfade " + juce::String (crossfade));
+                    }
+                }
+            }
+        }
+
+        void sweepMorph()
+        {
+            resetParameters();
+            set ("morph", 1.f);
+
+            for (auto from : getDevices())
+            {
+                for (auto to : getDevices())
+                {
+                    set ("morphFrom", static_cast<float>(static_cast<int>(from)));
+                    set ("morphTo", static_cast<float>(static_cast<int>(to)));
+
+                    for (auto amount : { 0.f, 0.3f, 1.f })
+                    {
+                        set ("morphAmount", amount);
+                        process ("morph " + getDeviceName (from) + " -> " + getDeviceName (to) + " at " + juce::String (amount));
+                    }
+                }
+            }
+
+            set ("morph", 0.f);
+            process ("morph off");
+        }
+
+        void sweepOversampling()
+        {
+            resetParameters();
+
+            for (auto morph : { 0.f, 1.f })
+            {
+                set ("morph", morph);
+
+                for (int factor = 0; factor < 3; ++factor)
+                {
+                    for (int quality = 0; quality < 3; ++quality)
+                    {
+                        set ("oversampling", static_cast<float>(factor));
+                        set ("oversamplingQuality", static_cast<float>(quality));
+
+                        for (auto device : getDevices())
+                        {
+                            setDevice (device);
+                            process ("oversampling " + juce::String (factor) + ", quality " + juce::String (quality)
+                                     + ", morph " + juce::String (morph) + ", " + getDeviceName (device));
+                        }
+                    }
+                }
+            }
+        }
+
+        void sweepFanOut()
+        {
+            resetParameters();
+
+            for (auto fanOut : { 1.f, 0.f, 1.f })
+            {
+                set ("fanOut", fanOut);
+
+                for (auto device : getDevices())
+                {
+                    setDevice (device);
+                    process ("fan out " + juce::String (fanOut) + ", " + getDeviceName (device));
+                }
+            }
+        }
+
+        // The kernel thread loads a device after the audio thread asks for it, so each device is processed, given
+        // time to load, then processed again to cover the moment the new kernel is swapped in.
+        void sweepConvolution (const juce::String& parameterID)
+        {
+            resetParameters();
+            set (parameterID, 1.f);
+
+            for (auto device : getDevices())
+            {
+                setDevice (device);
+                process (parameterID + ", " + getDeviceName (device) + " requested");
+                juce::Thread::sleep (500);
+                process (parameterID + ", " + getDeviceName (device) + " loaded");
+            }
+
+            set (parameterID, 0.f);
+            process (parameterID + " off");
+        }
+
+        void sweepChannelOptions()
+        {
+            resetParameters();
+
+            for (auto lfeBypass : { 0.f, 1.f })
+            {
+                for (auto centrePhone : { 0.f, 1.f })
+                {
+                    set ("lfeBypass", lfeBypass);
+                    set ("centrePhone", centrePhone);
+
+                    for (auto device : getDevices())
+                    {
+                        setDevice (device);
+                        process ("lfeBypass " + juce::String (lfeBypass) + ", centrePhone " + juce::String (centrePhone)
+                                 + ", " + getDeviceName (device));
+                    }
+                }
+            }
+        }
+
+        void sweepLoudnessMatch()
+        {
+            resetParameters();
+
+            for (int mode = 0; mode < 3; ++mode)
+            {
+                set ("loudnessMatch", static_cast<float>(mode));
+
+                for (auto linearPhase : { 0.f, 1.f })
+                {
+                    set ("linearPhase", linearPhase);
+
+                    for (auto device : getDevices())
+                    {
+                        setDevice (device);
+                        process ("loudnessMatch " + juce::String (mode) + ", linearPhase " + juce::String (linearPhase)
+                                 + ", " + getDeviceName (device));
+                    }
+                }
+            }
+        }
+
+        // Through the power parameter and through the host's own bypass, fading out and back, warm and cold.
+        void sweepBypass()
+        {
+            resetParameters();
+
+            for (auto keepWarm : { 0.f, 1.f })
+            {
+                set ("keepWarm", keepWarm);
+                auto warmth = ", keepWarm " + juce::String (keepWarm);
+
+                set ("power", 1.f);
+                process ("power on" + warmth);
+                process ("power on, faded out" + warmth);
+                setDevice (Device::phone);
+                process ("device change while bypassed" + warmth);
+                set ("power", 0.f);
+                process ("power off" + warmth);
+
+                process ("host bypass" + warmth, Input::noise, true);
+                process ("host bypass, faded out" + warmth, Input::noise, true);
+                process ("host bypass released" + warmth);
+            }
+        }
+
+        // Silence until the processor sleeps, waking it, and garbage from upstream.
+        void sweepSleep()
+        {
+            resetParameters();
+
+            auto totalSamples = std::accumulate (blockSizes.begin(), blockSizes.end(), 0);
+            auto samplesToSleep = processor.getTailLengthSeconds() * sampleRate + processor.getLatencySamples();
+            auto callsToSleep = static_cast<int>(std::ceil (samplesToSleep / totalSamples)) + 2;
+
+            for (int i = 0; i < callsToSleep; ++i)
+                process ("silence", Input::silence);
+
+            setDevice (Device::car);
+            process ("device change while asleep", Input::silence);
+            process ("waking up");
+            process ("NaN and Inf input", Input::garbage);
+            process ("after NaN and Inf input");
+        }
+
+        // Program changes at sample positions inside the blocks, on every render path.
+        void sweepProgramChanges()
+        {
+            auto devices = getDevices();
+
+            for (juce::String path : { "", "morph", "fanOut", "oversampling", "linearPhase" })
+            {
+                resetParameters();
+
+                for (int i = 0; i < devices.size(); ++i)
+                    midi.addEvent (juce::MidiMessage::programChange (1, static_cast<int>(devices[i])), (i * 37) % maximumBlockSize);
+
+                if (path.isNotEmpty())
+                    set (path, 1.f);
+
+                process ("program changes, " + (path.isNotEmpty() ? path : juce::String ("biquad")));
+            }
+
+            midi.clear();
+        }
+
+        // Device, render-path and morph automation landing between blocks. Path changes are deferred to the
+        // message thread, so each step is followed by the blocks rendered once they have been applied.
+        void sweepAutomation()
+        {
+            checkListenerLocksAreCaught();
+            auto devices = getDevices();
+
+            for (juce::String path : { "", "measured", "linearPhase", "oversampling", "fanOut" })
+            {
+                resetParameters();
+
+                if (path.isNotEmpty())
+                    set (path, 1.f);
+
+                juce::Thread::sleep (settleTimeMs);
+                auto pathName = path.isNotEmpty() ? path : juce::String ("biquad");
+
+                for (int i = 0; i + 1 < devices.size(); ++i)
+                {
+                    auto from = getDeviceName (devices[i]), to = getDeviceName (devices[i + 1]);
+                    processAutomated ("automated " + from + " -> " + to + ", " + pathName,
+                                      { { from, 1.f }, { to, 1.f }, { from, 0.f }, { to, 0.f }, { from, 1.f } });
+                }
+            }
+
+            resetParameters();
+            auto first = getDeviceName (devices.getFirst()), last = getDeviceName (devices.getLast());
+
+            processAutomated ("automated linear phase on", { { "linearPhase", 1.f }, { last, 1.f } });
+            processAutomated ("automated linear phase off", { { "linearPhase", 0.f }, { first, 1.f } });
+            processAutomated ("automated measured on and off", { { "measured", 1.f }, { last, 1.f }, { "measured", 0.f } });
+            processAutomated ("automated oversampling", { { "oversampling", 1.f }, { "oversamplingQuality", 2.f }, { "oversampling", 2.f },
+                                                          { last, 1.f }, { "oversampling", 0.f } });
+            processAutomated ("automated morph", { { "morph", 1.f }, { "morphFrom", static_cast<float>(static_cast<int>(devices.getFirst())) },
+                                                   { "morphTo", static_cast<float>(static_cast<int>(devices.getLast())) },
+                                                   { "morphAmount", 0.5f }, { "morphAmount", 1.f } });
+            processAutomated ("automated morph off", { { "morphAmount", 0.f }, { "morph", 0.f } });
+        }
+
+        // A listener that locks on the audio thread must still be reported while JUCE's own lock is let through,
+        // or the automation steps above would prove nothing about ours.
+        void checkListenerLocksAreCaught()
+        {
+            struct LockingListener  : juce::AudioProcessorValueTreeState::Listener
+            {
+                void parameterChanged (const juce::String&, float) override { const juce::ScopedLock sl (lock); }
+                juce::CriticalSection lock;
+            };
+
+            resetParameters();
+            LockingListener listener;
+            processor.apvts.addParameterListener ("crossfade", &listener);
+
+            {
+                RealtimeChecker::ScopedRealtimeSection realtime;
+                automate ("crossfade", 100.f);
+            }
+
+            auto report = RealtimeChecker::takeReport();
+            processor.apvts.removeParameterListener ("crossfade", &listener);
+            ++numSteps;
+
+            if (report.counts[static_cast<size_t>(RealtimeChecker::Violation::lock)] == 0)
+            {
+                failedSteps.add ("locking listener");
+                std::cout << "FAILED " << name << ", a listener that locks during automation went unreported" << std::endl;
+            }
+        }
+
+        //==============================================================================
+        juce::String name;
+        QwikRefAudioProcessor processor;
+        bool supported { false };
+
+        juce::AudioBuffer<SampleType> noise, work;
+        std::vector<juce::AudioBuffer<SampleType>> views;
+        juce::MidiBuffer midi;
+
+        int numSteps { 0 };
+        juce::StringArray failedSteps;
+    };
+
+    template <typename SampleType>
+    int runTest (const juce::String& precision, const juce::String& layoutName, const juce::AudioChannelSet& layout, bool withDeviceOutputs)
+    {
+        // Made and destroyed on the message thread, as hosts do, so the processor's timer never outlives it.
+        std::unique_ptr<RealtimeSafetyTest<SampleType>> test;
+        callOnMessageThread ([&] { test = std::make_unique<RealtimeSafetyTest<SampleType>> (precision + " " + layoutName, layout, withDeviceOutputs); });
+
+        auto failures = test->run();
+        callOnMessageThread ([&] { test.reset(); });
+
+        return failures;
+    }
+}
+
+//==============================================================================
+int main (int, char*[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    std::atomic<int> failures { 0 };
+
+    // The tests play the host's audio thread; this one stays the message thread, so whatever the processor
+    // defers to its timer really gets there.
+    juce::Thread::launch ([&failures]
+    {
+        failures += runTest<float> ("float", "stereo with device outputs", juce::AudioChannelSet::stereo(), true);
+        failures += runTest<double> ("double", "stereo with device outputs", juce::AudioChannelSet::stereo(), true);
+        failures += runTest<float> ("float", "5.1", juce::AudioChannelSet::create5point1(), false);
+        failures += runTest<double> ("double", "5.1", juce::AudioChannelSet::create5point1(), false);
+
+        juce::MessageManager::getInstance()->stopDispatchLoop();
+    });
+
+    juce::MessageManager::getInstance()->runDispatchLoop();
+
+    if (failures > 0)
+    {
+        std::cout << failures << " steps broke realtime rules" << std::endl;
+        return 1;
+    }
+
+    std::cout << "processBlock stayed realtime safe throughout" << std::endl;
+    return 0;
+}
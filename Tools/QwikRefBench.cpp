@@ -0,0 +1,490 @@
+/*
+  ==============================================================================
+
+    QwikRefBench.cpp
+
+    processBlock micro-benchmarks. Sweeps device profiles x block sizes x
+    sample rates x channel layouts through a headless QwikRefAudioProcessor
+    and, for comparison, through a plain chain of juce::dsp::IIR::Filter
+    running the same coefficients. Every run is warmed up and repeated, and
+    the results are written as JSON so releases can be compared.
+
+    Usage: QwikRefBench [--out=<file.json>] [--devices=car,phone,...]
+                        [--blocks=16,256,...] [--rates=44100,96000,...]
+                        [--layouts=mono,stereo,5.1,7.1.4] [--precision=float,double]
+                        [--kernels=processor,iir] [--seconds=<audio per run>]
+                        [--warmup=<runs>] [--repeats=<runs>]
+
+  ==============================================================================
+*/
+
+#include <iostream>
+#include <numeric>
+#include "../Source/PluginProcessor.h"
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+    struct Options
+    {
+        juce::File output;
+        juce::Array<Device> devices;
+        juce::Array<int> blockSizes { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+        juce::Array<double> sampleRates { 44100.0, 48000.0, 88200.0, 96000.0, 192000.0, 384000.0 };
+        juce::StringArray layouts { "mono", "stereo", "5.1", "7.1.4" };
+        juce::StringArray precisions { "float" };
+        juce::StringArray kernels { "processor", "iir" };
+        double seconds { 0.25 };
+        int warmup { 2 };
+        int repeats { 7 };
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: QwikRefBench [--out=<file.json>] [--devices=car,phone,...]" << std::endl
+                  << "                    [--blocks=16,256,...] [--rates=44100,96000,...]" << std::endl
+                  << "                    [--layouts=mono,stereo,5.1,7.1.4] [--precision=float,double]" << std::endl
+                  << "                    [--kernels=processor,iir] [--seconds=<audio per run>]" << std::endl
+                  << "                    [--warmup=<runs>] [--repeats=<runs>]" << std::endl
+                  << std::endl
+                  << "Times processBlock for every combination and writes the results as JSON" << std::endl
+                  << "to --out (default: stdout)." << std::endl;
+    }
+
+    juce::StringArray parseList (const juce::ArgumentList& args, const juce::String& option)
+    {
+        auto list = juce::StringArray::fromTokens (args.getValueForOption (option), ",", {});
+        list.trim();
+        list.removeEmptyStrings();
+        return list;
+    }
+
+    juce::AudioChannelSet getLayout (const juce::String& name)
+    {
+        if (name == "mono")   return juce::AudioChannelSet::mono();
+        if (name == "stereo") return juce::AudioChannelSet::stereo();
+        if (name == "5.1")    return juce::AudioChannelSet::create5point1();
+        if (name == "7.1")    return juce::AudioChannelSet::create7point1();
+        if (name == "7.1.4")  return juce::AudioChannelSet::create7point1point4();
+
+        return juce::AudioChannelSet::disabled();
+    }
+
+    bool parseArguments (const juce::ArgumentList& args, Options& options)
+    {
+        if (args.containsOption ("--help|-h"))
+            return false;
+
+        if (args.containsOption ("--out"))
+            options.output = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--out"));
+
+        auto requested = parseList (args, "--devices");
+
+        for (auto& profile : deviceProfiles)
+            if (requested.isEmpty() || requested.contains (profile.parameterID))
+                options.devices.add (profile.device);
+
+        if (args.containsOption ("--blocks"))
+        {
+            options.blockSizes.clear();
+
+            for (auto& size : parseList (args, "--blocks"))
+                options.blockSizes.add (juce::jlimit (1, 1 << 16, size.getIntValue()));
+        }
+
+        if (args.containsOption ("--rates"))
+        {
+            options.sampleRates.clear();
+
+            for (auto& rate : parseList (args, "--rates"))
+                options.sampleRates.add (juce::jlimit (8000.0, 768000.0, rate.getDoubleValue()));
+        }
+
+        if (args.containsOption ("--layouts"))
+            options.layouts = parseList (args, "--layouts");
+
+        if (args.containsOption ("--precision"))
+            options.precisions = parseList (args, "--precision");
+
+        if (args.containsOption ("--kernels"))
+            options.kernels = parseList (args, "--kernels");
+
+        if (args.containsOption ("--seconds"))
+            options.seconds = juce::jmax (0.001, args.getValueForOption ("--seconds").getDoubleValue());
+
+        if (args.containsOption ("--warmup"))
+            options.warmup = juce::jmax (0, args.getValueForOption ("--warmup").getIntValue());
+
+        if (args.containsOption ("--repeats"))
+            options.repeats = juce::jmax (1, args.getValueForOption ("--repeats").getIntValue());
+
+        for (auto& layout : options.layouts)
+        {
+            if (getLayout (layout).isDisabled())
+            {
+                std::cerr << "Unknown layout " << layout << std::endl;
+                return false;
+            }
+        }
+
+        if (options.devices.isEmpty())
+            std::cerr << "No known devices in --devices" << std::endl;
+
+        return ! options.devices.isEmpty() && ! options.blockSizes.isEmpty() && ! options.sampleRates.isEmpty();
+    }
+
+    juce::uint64 readCycleCounter() noexcept
+    {
+       #if JUCE_INTEL
+        return static_cast<juce::uint64>(__rdtsc());
+       #else
+        return 0;
+       #endif
+    }
+
+   #if JUCE_INTEL
+    constexpr bool hasCycleCounter = true;
+   #else
+    constexpr bool hasCycleCounter = false;
+   #endif
+
+    struct Run
+    {
+        double nanoseconds { 0.0 };
+        double cycles { 0.0 };
+    };
+
+    // Times 'process' over numBlocks blocks, warmup runs first, and keeps the timed repeats.
+    template <typename Process>
+    std::vector<Run> measure (const Options& options, int numBlocks, Process&& process)
+    {
+        std::vector<Run> runs;
+
+        for (int i = 0; i < options.warmup + options.repeats; ++i)
+        {
+            auto startTicks = juce::Time::getHighResolutionTicks();
+            auto startCycles = readCycleCounter();
+
+            for (int block = 0; block < numBlocks; ++block)
+                process();
+
+            auto cycles = static_cast<double>(readCycleCounter() - startCycles);
+            auto seconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+            if (i >= options.warmup)
+                runs.push_back ({ seconds * 1.0e9, cycles });
+        }
+
+        return runs;
+    }
+
+    // White noise at -12 dBFS: loud enough that the processor never goes to sleep on it.
+    template <typename SampleType>
+    void fillWithNoise (juce::AudioBuffer<SampleType>& buffer)
+    {
+        juce::Random random (0x5eed);
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                buffer.setSample (channel, i, static_cast<SampleType>((random.nextFloat() * 2.f - 1.f) * 0.25f));
+    }
+
+    // The path before CoefficientBank/BiquadCascade: one juce::dsp::IIR::Filter per band per channel.
+    template <typename SampleType>
+    class IirReference
+    {
+    public:
+        void prepare (const CoefficientBank& bank, Device device, int numChannels, int blockSize)
+        {
+            filters.clear();
+            filters.reserve (static_cast<size_t>(numChannels) * numBands);
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                for (auto& c : bank.getProfile (device))
+                {
+                    filters.emplace_back();
+                    filters.back().coefficients = new juce::dsp::IIR::Coefficients<SampleType> (
+                        static_cast<SampleType>(c.b0), static_cast<SampleType>(c.b1), static_cast<SampleType>(c.b2),
+                        static_cast<SampleType>(1), static_cast<SampleType>(c.a1), static_cast<SampleType>(c.a2));
+                    filters.back().prepare ({ bank.getSampleRate(), static_cast<juce::uint32>(blockSize), 1 });
+                }
+            }
+        }
+
+        void process (juce::AudioBuffer<SampleType>& buffer) noexcept
+        {
+            juce::dsp::AudioBlock<SampleType> block (buffer);
+
+            for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+            {
+                auto channelBlock = block.getSingleChannelBlock (channel);
+
+                for (size_t band = 0; band < numBands; ++band)
+                    filters[channel * numBands + band].process (juce::dsp::ProcessContextReplacing<SampleType> (channelBlock));
+            }
+        }
+
+    private:
+        std::vector<juce::dsp::IIR::Filter<SampleType>> filters;
+    };
+
+    class Bench
+    {
+    public:
+        explicit Bench (const Options& optionsToUse) : options (optionsToUse) {}
+
+        void runAll()
+        {
+            for (auto& layoutName : options.layouts)
+            {
+                auto layout = getLayout (layoutName);
+
+                for (auto& precision : options.precisions)
+                {
+                    if (options.kernels.contains ("processor"))
+                        runProcessor (layoutName, layout, precision);
+
+                    if (options.kernels.contains ("iir"))
+                    {
+                        if (precision == "double")
+                            runIir<double> (layoutName, layout.size(), precision);
+                        else
+                            runIir<float> (layoutName, layout.size(), precision);
+                    }
+                }
+            }
+        }
+
+        juce::var getResults() const { return results; }
+
+    private:
+        void runProcessor (const juce::String& layoutName, const juce::AudioChannelSet& layout, const juce::String& precision)
+        {
+            auto processor = std::make_unique<QwikRefAudioProcessor>();
+
+            auto buses = processor->getBusesLayout();
+            buses.getChannelSet (true, 0) = layout;
+            buses.getChannelSet (false, 0) = layout;
+
+            if (! processor->setBusesLayout (buses))
+            {
+                std::cerr << "Skipping " << layoutName << ": layout not supported" << std::endl;
+                return;
+            }
+
+            auto useDouble = precision == "double";
+            processor->setProcessingPrecision (useDouble ? juce::AudioProcessor::doublePrecision : juce::AudioProcessor::singlePrecision);
+            processor->apvts.getParameter ("power")->setValueNotifyingHost (0.f);
+
+            for (auto device : options.devices)
+            {
+                for (auto& profile : deviceProfiles)
+                    if (hasParameter (profile))
+                        processor->apvts.getParameter (profile.parameterID)->setValueNotifyingHost (profile.device == device ? 1.f : 0.f);
+
+                for (auto sampleRate : options.sampleRates)
+                {
+                    for (auto blockSize : options.blockSizes)
+                    {
+                        processor->setRateAndBufferSizeDetails (sampleRate, blockSize);
+                        processor->prepareToPlay (sampleRate, blockSize);
+
+                        if (useDouble)
+                            runProcessorBlocks<double> (*processor, layoutName, layout.size(), precision, device, sampleRate, blockSize);
+                        else
+                            runProcessorBlocks<float> (*processor, layoutName, layout.size(), precision, device, sampleRate, blockSize);
+
+                        processor->releaseResources();
+                    }
+                }
+            }
+        }
+
+        template <typename SampleType>
+        void runProcessorBlocks (QwikRefAudioProcessor& processor, const juce::String& layoutName, int numChannels,
+                                 const juce::String& precision, Device device, double sampleRate, int blockSize)
+        {
+            juce::AudioBuffer<SampleType> noise (processor.getTotalNumOutputChannels(), blockSize), buffer (noise);
+            juce::MidiBuffer midi;
+            fillWithNoise (noise);
+
+            auto runs = measure (options, getNumBlocks (sampleRate, blockSize), [&]
+            {
+                buffer.makeCopyOf (noise, true);
+                processor.processBlock (buffer, midi);
+            });
+
+            addResult ("processor", precision, layoutName, numChannels, device, sampleRate, blockSize, runs);
+        }
+
+        template <typename SampleType>
+        void runIir (const juce::String& layoutName, int numChannels, const juce::String& precision)
+        {
+            CoefficientBank bank;
+            IirReference<SampleType> reference;
+
+            for (auto device : options.devices)
+            {
+                for (auto sampleRate : options.sampleRates)
+                {
+                    bank.prepare (sampleRate);
+
+                    for (auto blockSize : options.blockSizes)
+                    {
+                        juce::AudioBuffer<SampleType> noise (numChannels, blockSize), buffer (noise);
+                        fillWithNoise (noise);
+                        reference.prepare (bank, device, numChannels, blockSize);
+
+                        auto runs = measure (options, getNumBlocks (sampleRate, blockSize), [&]
+                        {
+                            buffer.makeCopyOf (noise, true);
+                            reference.process (buffer);
+                        });
+
+                        addResult ("iir", precision, layoutName, numChannels, device, sampleRate, blockSize, runs);
+                    }
+                }
+            }
+        }
+
+        int getNumBlocks (double sampleRate, int blockSize) const
+        {
+            return juce::jmax (1, juce::roundToInt (options.seconds * sampleRate / blockSize));
+        }
+
+        void addResult (const juce::String& kernel, const juce::String& precision, const juce::String& layoutName, int numChannels,
+                        Device device, double sampleRate, int blockSize, const std::vector<Run>& runs)
+        {
+            auto samples = static_cast<double>(getNumBlocks (sampleRate, blockSize)) * blockSize;
+
+            std::vector<double> nsPerSample, cyclesPerSample;
+
+            for (auto& run : runs)
+            {
+                nsPerSample.push_back (run.nanoseconds / samples);
+                cyclesPerSample.push_back (run.cycles / samples);
+            }
+
+            auto stats = summarise (nsPerSample);
+            auto median = static_cast<double>(stats.getProperty ("median", 0.0));
+
+            auto* result = new juce::DynamicObject();
+            result->setProperty ("kernel", kernel);
+            result->setProperty ("precision", precision);
+            result->setProperty ("layout", layoutName);
+            result->setProperty ("channels", numChannels);
+            result->setProperty ("device", getDeviceProfile (device).parameterID);
+            result->setProperty ("sampleRate", sampleRate);
+            result->setProperty ("blockSize", blockSize);
+            result->setProperty ("nsPerSample", stats);
+            result->setProperty ("cyclesPerSample", hasCycleCounter ? summarise (cyclesPerSample).getProperty ("median", {}) : juce::var());
+
+            // Throughput in sample frames (all channels) per second, and how much of real time one instance uses.
+            result->setProperty ("megasamplesPerSecond", median > 0.0 ? 1.0e3 / median : 0.0);
+            result->setProperty ("realtimeFraction", median * 1.0e-9 * sampleRate);
+
+            results.append (juce::var (result));
+
+            std::cerr << kernel << " " << precision << " " << layoutName << " " << getDeviceProfile (device).parameterID
+                      << " " << sampleRate << " Hz, " << blockSize << " samples: "
+                      << juce::String (median, 2) << " ns/sample" << std::endl;
+        }
+
+        static juce::var summarise (std::vector<double> values)
+        {
+            auto* stats = new juce::DynamicObject();
+
+            if (values.empty())
+                return juce::var (stats);
+
+            std::sort (values.begin(), values.end());
+
+            auto mean = std::accumulate (values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+            auto variance = 0.0;
+
+            for (auto value : values)
+                variance += (value - mean) * (value - mean);
+
+            auto middle = values.size() / 2;
+            auto median = values.size() % 2 != 0 ? values[middle] : 0.5 * (values[middle - 1] + values[middle]);
+
+            stats->setProperty ("min", values.front());
+            stats->setProperty ("median", median);
+            stats->setProperty ("mean", mean);
+            stats->setProperty ("max", values.back());
+            stats->setProperty ("stddev", std::sqrt (variance / static_cast<double>(values.size())));
+            return juce::var (stats);
+        }
+
+        const Options& options;
+        juce::var results { juce::Array<juce::var>() };
+    };
+
+    juce::var makeReport (const Options& options, const juce::var& results)
+    {
+        auto* settings = new juce::DynamicObject();
+        settings->setProperty ("seconds", options.seconds);
+        settings->setProperty ("warmup", options.warmup);
+        settings->setProperty ("repeats", options.repeats);
+
+        auto* report = new juce::DynamicObject();
+        report->setProperty ("tool", "QwikRefBench");
+        report->setProperty ("time", juce::Time::getCurrentTime().toISO8601 (true));
+        report->setProperty ("cpu", juce::SystemStats::getCpuModel());
+        report->setProperty ("numCpus", juce::SystemStats::getNumCpus());
+        report->setProperty ("os", juce::SystemStats::getOperatingSystemName());
+       #if JUCE_DEBUG
+        report->setProperty ("debugBuild", true);
+       #else
+        report->setProperty ("debugBuild", false);
+       #endif
+        report->setProperty ("settings", juce::var (settings));
+        report->setProperty ("results", results);
+        return juce::var (report);
+    }
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    Options options;
+
+    if (! parseArguments (juce::ArgumentList (argc, argv), options))
+    {
+        printUsage();
+        return 1;
+    }
+
+   #if JUCE_DEBUG
+    std::cerr << "Warning: this is a debug build, timings won't mean much" << std::endl;
+   #endif
+
+    Bench bench (options);
+    bench.runAll();
+
+    auto json = juce::JSON::toString (makeReport (options, bench.getResults()));
+
+    if (options.output == juce::File())
+    {
+        std::cout << json << std::endl;
+        return 0;
+    }
+
+    if (! options.output.replaceWithText (json))
+    {
+        std::cerr << "Can't write " << options.output.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    std::cerr << "wrote  " << options.output.getFullPathName() << std::endl;
+    return 0;
+}
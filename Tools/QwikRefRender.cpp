@@ -0,0 +1,354 @@
+/*
+  ==============================================================================
+
+    QwikRefRender.cpp
+
+    Offline batch renderer. Streams every input file through every device
+    profile and writes one file per device, e.g. mix.wav -> mix_car.wav.
+    Each file is read once, by one headless QwikRefAudioProcessor in fan-out
+    mode that renders every device in the same pass and hands each one out
+    on its own output bus. Files run in parallel on a thread pool, reading
+    and writing in blocks so nothing is ever held in memory whole.
+
+    Usage: QwikRefRender [--out=<folder>] [--block=<samples>] [--threads=<n>]
+                         [--devices=car,phone,...] <files...>
+
+  ==============================================================================
+*/
+
+#include <deque>
+#include <iostream>
+#include "../Source/PluginProcessor.h"
+
+namespace
+{
+    struct Options
+    {
+        juce::File outputFolder;
+        int blockSize { 65536 };
+        int numThreads { juce::SystemStats::getNumCpus() };
+        juce::Array<Device> devices;
+        juce::Array<juce::File> inputs;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: QwikRefRender [--out=<folder>] [--block=<samples>] [--threads=<n>]" << std::endl
+                  << "                     [--devices=car,phone,...] <files...>" << std::endl
+                  << std::endl
+                  << "Renders each WAV/AIFF file through every device profile (or just --devices)," << std::endl
+                  << "writing <name>_<device>.<ext> into --out (default: next to the input)." << std::endl;
+    }
+
+    bool parseArguments (const juce::ArgumentList& args, Options& options)
+    {
+        if (args.containsOption ("--help|-h"))
+            return false;
+
+        if (args.containsOption ("--out"))
+            options.outputFolder = juce::File::getCurrentWorkingDirectory().getChildFile (args.getValueForOption ("--out"));
+
+        if (args.containsOption ("--block"))
+            options.blockSize = juce::jmax (32, args.getValueForOption ("--block").getIntValue());
+
+        if (args.containsOption ("--threads"))
+            options.numThreads = juce::jmax (1, args.getValueForOption ("--threads").getIntValue());
+
+        auto requested = juce::StringArray::fromTokens (args.getValueForOption ("--devices"), ",", {});
+        requested.trim();
+        requested.removeEmptyStrings();
+
+        for (auto& profile : deviceProfiles)
+            if (hasParameter (profile) && (requested.isEmpty() || requested.contains (profile.parameterID)))
+                options.devices.add (profile.device);
+
+        for (auto& arg : args.arguments)
+            if (! arg.isOption())
+                options.inputs.add (arg.resolveAsFile());
+
+        if (options.devices.isEmpty())
+            std::cerr << "No known devices in --devices" << std::endl;
+
+        return ! options.inputs.isEmpty() && ! options.devices.isEmpty();
+    }
+
+    // Streams one file through every requested device profile at once.
+    class RenderJob  : public juce::ThreadPoolJob
+    {
+    public:
+        RenderJob (juce::AudioFormatManager& formatsToUse, const juce::File& inputFile, const juce::File& outputFolder,
+                   const juce::Array<Device>& devicesToRender, int blockSizeToUse)
+            : juce::ThreadPoolJob (inputFile.getFileName()),
+              formats (formatsToUse), input (inputFile), blockSize (blockSizeToUse)
+        {
+            for (auto device : devicesToRender)
+            {
+                auto name = input.getFileNameWithoutExtension() + "_" + getDeviceProfile (device).parameterID + input.getFileExtension();
+                outputs.push_back ({ device, outputFolder.getChildFile (name), 0, nullptr });
+            }
+        }
+
+        // Message thread: the processor's parameter tree needs it around while being built.
+        bool prepare()
+        {
+            reader.reset (formats.createReaderFor (input));
+
+            if (reader == nullptr)
+                return fail ("can't read " + input.getFullPathName());
+
+            auto* format = formats.findFormatForFileExtension (input.getFileExtension());
+
+            if (format == nullptr)
+                return fail ("no writer for " + input.getFileExtension() + " files");
+
+            auto numChannels = static_cast<int>(reader->numChannels);
+            auto bitDepth = format->getPossibleBitDepths().contains (static_cast<int>(reader->bitsPerSample))
+                                ? static_cast<int>(reader->bitsPerSample) : 24;
+
+            processor = std::make_unique<QwikRefAudioProcessor>();
+
+            // Device buses follow the table order, right after the main output; only the requested ones are switched on.
+            auto layout = processor->getBusesLayout();
+            auto channelSet = juce::AudioChannelSet::canonicalChannelSet (numChannels);
+            layout.getChannelSet (true, 0) = channelSet;
+            layout.getChannelSet (false, 0) = channelSet;
+
+            auto bus = 1;
+
+            for (auto& profile : deviceProfiles)
+            {
+                if (! hasParameter (profile))
+                    continue;
+
+                for (auto& output : outputs)
+                    if (output.device == profile.device && bus < layout.outputBuses.size())
+                        output.bus = bus;
+
+                ++bus;
+            }
+
+            for (int i = 1; i < layout.outputBuses.size(); ++i)
+                layout.outputBuses.getReference (i) = juce::AudioChannelSet::disabled();
+
+            for (auto& output : outputs)
+                if (output.bus > 0)
+                    layout.outputBuses.getReference (output.bus) = channelSet;
+
+            if (! processor->setBusesLayout (layout))
+                return fail (juce::String (numChannels) + " channel files aren't supported");
+
+            for (auto& output : outputs)
+            {
+                if (output.bus == 0)
+                    return fail (juce::String ("no output bus for ") + getDeviceProfile (output.device).name);
+
+                output.file.deleteFile();
+                std::unique_ptr<juce::OutputStream> stream (output.file.createOutputStream());
+
+                if (stream != nullptr)
+                    output.writer.reset (format->createWriterFor (stream.get(), reader->sampleRate, static_cast<unsigned int>(numChannels),
+                                                                  bitDepth, {}, 0));
+
+                if (output.writer == nullptr)
+                    return fail ("can't write " + output.file.getFullPathName());
+
+                stream.release();
+            }
+
+            processor->apvts.getParameter ("fanOut")->setValueNotifyingHost (1.f);
+            processor->apvts.getParameter ("power")->setValueNotifyingHost (0.f);
+
+            processor->setRateAndBufferSizeDetails (reader->sampleRate, blockSize);
+            processor->prepareToPlay (reader->sampleRate, blockSize);
+            return true;
+        }
+
+        JobStatus runJob() override
+        {
+            auto numChannels = static_cast<int>(reader->numChannels);
+            auto totalLength = reader->lengthInSamples;
+
+            // The file is read into the main input channels once; every device comes back on its own bus.
+            juce::AudioBuffer<float> buffer (juce::jmax (processor->getTotalNumInputChannels(), processor->getTotalNumOutputChannels()),
+                                             blockSize);
+            juce::MidiBuffer midi;
+
+            // Latency is trimmed from the start and flushed out at the end, so outputs line up with the input.
+            auto samplesToSkip = processor->getLatencySamples();
+            juce::int64 readPosition = 0, samplesLeftToWrite = totalLength;
+
+            while (samplesLeftToWrite > 0)
+            {
+                if (shouldExit())
+                    return finishWithError ("cancelled");
+
+                buffer.clear();
+
+                auto samplesToRead = static_cast<int>(juce::jlimit ((juce::int64) 0, (juce::int64) blockSize, totalLength - readPosition));
+
+                if (samplesToRead > 0 && ! reader->read (&buffer, 0, samplesToRead, readPosition, true, true))
+                    return finishWithError ("read error in " + input.getFullPathName());
+
+                readPosition += samplesToRead;
+                processor->processBlock (buffer, midi);
+
+                auto start = juce::jmin (samplesToSkip, blockSize);
+                samplesToSkip -= start;
+
+                auto samplesToWrite = static_cast<int>(juce::jmin ((juce::int64) (blockSize - start), samplesLeftToWrite));
+
+                for (auto& output : outputs)
+                {
+                    auto busBuffer = processor->getBusBuffer (buffer, false, output.bus);
+                    jassert (busBuffer.getNumChannels() == numChannels);
+
+                    if (samplesToWrite > 0 && ! output.writer->writeFromAudioSampleBuffer (busBuffer, start, samplesToWrite))
+                        return finishWithError ("write error in " + output.file.getFullPathName());
+                }
+
+                samplesLeftToWrite -= samplesToWrite;
+            }
+
+            for (auto& output : outputs)
+                output.writer.reset();
+
+            succeeded = true;
+            return jobHasFinished;
+        }
+
+        // Message thread, once the job is done.
+        void release()
+        {
+            if (processor != nullptr)
+                processor->releaseResources();
+
+            processor.reset();
+
+            for (auto& output : outputs)
+                output.writer.reset();
+
+            reader.reset();
+        }
+
+        bool hasSucceeded() const noexcept { return succeeded; }
+        const juce::String& getError() const noexcept { return error; }
+        const juce::File& getInputFile() const noexcept { return input; }
+
+        juce::Array<juce::File> getOutputFiles() const
+        {
+            juce::Array<juce::File> files;
+
+            for (auto& output : outputs)
+                files.add (output.file);
+
+            return files;
+        }
+
+    private:
+        struct Output
+        {
+            Device device;
+            juce::File file;
+            int bus;
+            std::unique_ptr<juce::AudioFormatWriter> writer;
+        };
+
+        bool fail (const juce::String& message)
+        {
+            error = message;
+            return false;
+        }
+
+        JobStatus finishWithError (const juce::String& message)
+        {
+            fail (message);
+            return jobHasFinished;
+        }
+
+        juce::AudioFormatManager& formats;
+        juce::File input;
+        int blockSize;
+
+        std::unique_ptr<juce::AudioFormatReader> reader;
+        std::vector<Output> outputs;
+        std::unique_ptr<QwikRefAudioProcessor> processor;
+
+        bool succeeded { false };
+        juce::String error;
+    };
+}
+
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    Options options;
+
+    if (! parseArguments (juce::ArgumentList (argc, argv), options))
+    {
+        printUsage();
+        return 1;
+    }
+
+    juce::AudioFormatManager formats;
+    formats.registerBasicFormats();
+
+    if (options.outputFolder != juce::File())
+        options.outputFolder.createDirectory();
+
+    std::deque<std::unique_ptr<RenderJob>> pending, running;
+
+    for (auto& input : options.inputs)
+    {
+        auto folder = options.outputFolder != juce::File() ? options.outputFolder : input.getParentDirectory();
+        pending.push_back (std::make_unique<RenderJob> (formats, input, folder, options.devices, options.blockSize));
+    }
+
+    juce::ThreadPool pool { juce::ThreadPoolOptions{}.withNumberOfThreads (options.numThreads) };
+    auto failures = 0;
+
+    // Keep a couple of files per core queued; each holds an open reader, its writers and a processor.
+    const auto maxJobsInFlight = static_cast<size_t>(options.numThreads * 2);
+
+    while (! pending.empty() || ! running.empty())
+    {
+        while (! pending.empty() && running.size() < maxJobsInFlight)
+        {
+            auto job = std::move (pending.front());
+            pending.pop_front();
+
+            if (! job->prepare())
+            {
+                std::cerr << "FAILED " << job->getInputFile().getFileName() << ": " << job->getError() << std::endl;
+                job->release();
+                ++failures;
+                continue;
+            }
+
+            pool.addJob (job.get(), false);
+            running.push_back (std::move (job));
+        }
+
+        if (running.empty())
+            continue;
+
+        auto job = std::move (running.front());
+        running.pop_front();
+        pool.waitForJobToFinish (job.get(), -1);
+
+        if (job->hasSucceeded())
+        {
+            for (auto& file : job->getOutputFiles())
+                std::cout << "wrote  " << file.getFullPathName() << std::endl;
+        }
+        else
+        {
+            std::cerr << "FAILED " << job->getInputFile().getFileName() << ": " << job->getError() << std::endl;
+            ++failures;
+        }
+
+        job->release();
+    }
+
+    return failures == 0 ? 0 : 1;
+}